@@ -0,0 +1,117 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+using GLib;
+
+[CCode (cheader_filename = "sys/inotify.h")]
+extern int inotify_init1(int flags);
+[CCode (cheader_filename = "sys/inotify.h")]
+extern int inotify_add_watch(int fd, string path, uint32 mask);
+
+[CCode (cheader_filename = "sys/inotify.h", cname = "IN_NONBLOCK")]
+extern const int IN_NONBLOCK;
+[CCode (cheader_filename = "sys/inotify.h", cname = "IN_CLOEXEC")]
+extern const int IN_CLOEXEC;
+[CCode (cheader_filename = "sys/inotify.h", cname = "IN_CLOSE_WRITE")]
+extern const uint32 IN_CLOSE_WRITE;
+[CCode (cheader_filename = "sys/inotify.h", cname = "IN_MOVED_TO")]
+extern const uint32 IN_MOVED_TO;
+[CCode (cheader_filename = "sys/inotify.h", cname = "IN_MOVED_FROM")]
+extern const uint32 IN_MOVED_FROM;
+[CCode (cheader_filename = "sys/inotify.h", cname = "IN_DELETE")]
+extern const uint32 IN_DELETE;
+[CCode (cheader_filename = "sys/inotify.h", cname = "IN_Q_OVERFLOW")]
+extern const uint32 IN_Q_OVERFLOW;
+
+/* The fixed part of an event, the name follows it, NUL padded to len */
+[CCode (cheader_filename = "sys/inotify.h", cname = "struct inotify_event", has_type_id = false)]
+struct InotifyEvent {
+        int wd;
+        uint32 mask;
+        uint32 cookie;
+        uint32 len;
+}
+
+/* Watches the ask-password directories with inotify directly. Files are
+ * reported only once complete, that is closed after writing or renamed
+ * into place, so the index never parses half written requests. */
+public class AskPasswordWatch : Object {
+
+        private int fd;
+        private IOChannel channel;
+        private HashTable<int, string> directories;
+
+        public signal void file_changed(string path);
+        public signal void file_removed(string path);
+
+        /* Events were lost, the directories have to be scanned again */
+        public signal void overflow();
+
+        public AskPasswordWatch() throws IOError {
+                fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+                if (fd < 0)
+                        throw new IOError.FAILED("Failed to set up inotify: %s", Posix.strerror(GLib.errno));
+
+                directories = new HashTable<int, string>(direct_hash, direct_equal);
+
+                channel = new IOChannel.unix_new(fd);
+                channel.set_close_on_unref(true);
+                channel.add_watch(IOCondition.IN, on_readable);
+        }
+
+        public void add_directory(string directory) throws IOError {
+                int wd = inotify_add_watch(fd, directory,
+                                           IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+                if (wd < 0)
+                        throw new IOError.FAILED("Failed to watch %s: %s", directory, Posix.strerror(GLib.errno));
+
+                directories[wd] = directory;
+        }
+
+        private bool on_readable(IOChannel source, IOCondition condition) {
+                /* uint32, for the alignment of struct inotify_event */
+                uint32 buffer[1024];
+                ssize_t n;
+
+                while ((n = Posix.read(fd, buffer, sizeof(uint32) * buffer.length)) > 0) {
+                        size_t offset = 0;
+
+                        while (offset < (size_t) n) {
+                                InotifyEvent* e = (InotifyEvent*) ((uint8*) buffer + offset);
+                                offset += sizeof(InotifyEvent) + e->len;
+
+                                if ((e->mask & IN_Q_OVERFLOW) != 0) {
+                                        overflow();
+                                        continue;
+                                }
+
+                                unowned string? directory = directories[e->wd];
+                                if (directory == null || e->len == 0)
+                                        continue;
+
+                                string path = Path.build_filename(directory, (string) ((uint8*) e + sizeof(InotifyEvent)));
+
+                                if ((e->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0)
+                                        file_changed(path);
+                                else
+                                        file_removed(path);
+                        }
+                }
+
+                return true;
+        }
+}
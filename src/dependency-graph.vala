@@ -0,0 +1,236 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+using GLib;
+
+public enum DependencyType {
+        REQUIRES,
+        WANTS,
+        AFTER,
+        BEFORE,
+        CONFLICTS
+}
+
+public const string[] DEPENDENCY_PROPERTIES = {
+        "Requires",
+        "Wants",
+        "After",
+        "Before",
+        "Conflicts"
+};
+
+/* Result of a breadth first walk. Nodes are in the order they were
+ * reached, parent is the index of the node they were reached from, -1
+ * for the start. */
+public class DependencyWalk {
+        public string[] ids = {};
+        public int[] depths = {};
+        public int[] parents = {};
+
+        /* True if the walk stopped at the node limit */
+        public bool truncated;
+}
+
+/* The dependencies between all units, kept in memory. Each unit is a
+ * node with one outgoing and one incoming edge set per dependency type.
+ * Nodes are created for every unit mentioned, loaded or not, and are
+ * never removed; a unit that goes away just loses its outgoing edges. */
+public class DependencyGraph : Object {
+
+        private const int N_TYPES = 5;
+
+        private Gee.HashMap<string, int> nodes;
+        private string[] names = {};
+
+        /* Indexed by node * N_TYPES + type */
+        private Gee.HashSet<int>[] forward = {};
+        private Gee.HashSet<int>[] backward = {};
+
+        public signal void changed();
+
+        public DependencyGraph() {
+                nodes = new Gee.HashMap<string, int>();
+        }
+
+        public static int type_from_property(string name) {
+                for (int t = 0; t < DEPENDENCY_PROPERTIES.length; t++)
+                        if (name == DEPENDENCY_PROPERTIES[t])
+                                return t;
+
+                return -1;
+        }
+
+        private int node(string id) {
+                if (nodes.has_key(id))
+                        return nodes[id];
+
+                int n = names.length;
+                names += id;
+                nodes[id] = n;
+
+                for (int t = 0; t < N_TYPES; t++) {
+                        forward += new Gee.HashSet<int>();
+                        backward += new Gee.HashSet<int>();
+                }
+
+                return n;
+        }
+
+        public bool contains(string id) {
+                return nodes.has_key(id);
+        }
+
+        /* Replaces the outgoing edges of one type */
+        public void set_edges(string id, DependencyType type, string[] targets) {
+                int n = node(id);
+                Gee.HashSet<int> out_edges = forward[n * N_TYPES + type];
+
+                foreach (int m in out_edges)
+                        backward[m * N_TYPES + type].remove(n);
+                out_edges.clear();
+
+                foreach (unowned string target in targets) {
+                        int m = node(target);
+                        out_edges.add(m);
+                        backward[m * N_TYPES + type].add(n);
+                }
+
+                changed();
+        }
+
+        /* Picks the dependency properties out of an a{sv} from GetAll */
+        public void set_properties(string id, Variant properties) {
+                VariantIter i = properties.iterator();
+                string name;
+                Variant value;
+
+                while (i.next("{sv}", out name, out value)) {
+                        int t = type_from_property(name);
+                        if (t >= 0)
+                                set_edges(id, (DependencyType) t, value.dup_strv());
+                }
+        }
+
+        public void clear_edges(string id) {
+                if (!nodes.has_key(id))
+                        return;
+
+                for (int t = 0; t < N_TYPES; t++)
+                        set_edges(id, (DependencyType) t, new string[0]);
+        }
+
+        /* Units that id points to with one of the types in mask */
+        public string[] get_edges(string id, uint mask, bool reverse = false) {
+                string[] r = {};
+
+                if (!nodes.has_key(id))
+                        return r;
+
+                unowned Gee.HashSet<int>[] edges = reverse ? backward : forward;
+                int n = nodes[id];
+
+                for (int t = 0; t < N_TYPES; t++) {
+                        if ((mask & (1 << t)) == 0)
+                                continue;
+
+                        foreach (int m in edges[n * N_TYPES + t])
+                                r += names[m];
+                }
+
+                return r;
+        }
+
+        private bool has_edges(int n, uint mask, bool reverse) {
+                unowned Gee.HashSet<int>[] edges = reverse ? backward : forward;
+
+                for (int t = 0; t < N_TYPES; t++)
+                        if ((mask & (1 << t)) != 0 && edges[n * N_TYPES + t].size > 0)
+                                return true;
+
+                return false;
+        }
+
+        /* Breadth first over the types in mask, following the edges
+         * backwards if reverse is set. With all dependency types this is
+         * the transitive closure of the start unit. */
+        public DependencyWalk walk(string id, uint mask, bool reverse, int limit) {
+                DependencyWalk w = new DependencyWalk();
+
+                if (!nodes.has_key(id))
+                        return w;
+
+                unowned Gee.HashSet<int>[] edges = reverse ? backward : forward;
+                Gee.HashSet<int> seen = new Gee.HashSet<int>();
+                int[] queue = { nodes[id] };
+
+                seen.add(nodes[id]);
+                w.ids += id;
+                w.depths += 0;
+                w.parents += -1;
+
+                for (int head = 0; head < queue.length; head++) {
+                        int n = queue[head];
+
+                        for (int t = 0; t < N_TYPES; t++) {
+                                if ((mask & (1 << t)) == 0)
+                                        continue;
+
+                                foreach (int m in edges[n * N_TYPES + t]) {
+                                        if (m in seen)
+                                                continue;
+
+                                        if (queue.length >= limit) {
+                                                w.truncated = true;
+                                                return w;
+                                        }
+
+                                        seen.add(m);
+                                        queue += m;
+                                        w.ids += names[m];
+                                        w.depths += w.depths[head] + 1;
+                                        w.parents += head;
+                                }
+                        }
+                }
+
+                return w;
+        }
+
+        /* Answers "why is this unit pulled in": walks the requires and
+         * wants edges backwards and returns the shortest chain from every
+         * unit that is not itself pulled in by anything. */
+        public string[] why(string id, int limit) {
+                uint mask = (1 << DependencyType.REQUIRES) | (1 << DependencyType.WANTS);
+                DependencyWalk w = walk(id, mask, true, limit);
+                string[] r = {};
+
+                for (int i = 1; i < w.ids.length; i++) {
+                        if (has_edges(nodes[w.ids[i]], mask, true))
+                                continue;
+
+                        /* The walk goes from the unit to the roots, the
+                         * chain reads better the other way around */
+                        string[] chain = {};
+                        for (int p = i; p >= 0; p = w.parents[p])
+                                chain += w.ids[p];
+
+                        r += string.joinv(" → ", chain);
+                }
+
+                return r;
+        }
+}
@@ -0,0 +1,294 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+using Gtk;
+using GLib;
+
+/* Draws the part of the dependency graph reachable from one unit, one
+ * column per hop. Scrolling zooms around the pointer, dragging pans and
+ * double clicking a unit makes it the new root. */
+public class DependencyGraphView : DrawingArea {
+
+        private const double COLUMN_WIDTH = 280;
+        private const double ROW_HEIGHT = 28;
+        private const double NODE_HEIGHT = 20;
+        private const int NODE_LIMIT = 500;
+
+        private DependencyGraph graph;
+
+        private string? root = null;
+        private uint mask = ~0U;
+        private bool reverse = false;
+
+        private DependencyWalk? walk = null;
+        private double[] xs = {};
+        private double[] ys = {};
+        private double[] widths = {};
+        private bool dirty = true;
+
+        private double scale = 1.0;
+        private double offset_x = 12;
+        private double offset_y = 12;
+
+        private bool dragging = false;
+        private double drag_x;
+        private double drag_y;
+
+        public signal void unit_activated(string id);
+
+        public DependencyGraphView(DependencyGraph graph) {
+                this.graph = graph;
+
+                add_events(Gdk.EventMask.SCROLL_MASK |
+                           Gdk.EventMask.BUTTON_PRESS_MASK |
+                           Gdk.EventMask.BUTTON_RELEASE_MASK |
+                           Gdk.EventMask.BUTTON1_MOTION_MASK);
+
+                /* Patches only mark the layout stale, it is redone once
+                 * when the next frame is drawn */
+                graph.changed.connect(() => {
+                        dirty = true;
+                        queue_draw();
+                });
+        }
+
+        public void show_root(string? id, uint mask, bool reverse) {
+                this.root = id;
+                this.mask = mask;
+                this.reverse = reverse;
+
+                scale = 1.0;
+                offset_x = 12;
+                offset_y = 12;
+
+                dirty = true;
+                queue_draw();
+        }
+
+        public DependencyWalk? get_walk() {
+                if (dirty)
+                        layout_nodes();
+
+                return walk;
+        }
+
+        private void layout_nodes() {
+                dirty = false;
+
+                if (root == null) {
+                        walk = null;
+                        xs = {};
+                        ys = {};
+                        widths = {};
+                        return;
+                }
+
+                walk = graph.walk(root, mask, reverse, NODE_LIMIT);
+
+                int[] rows = {};
+                xs = new double[walk.ids.length];
+                ys = new double[walk.ids.length];
+                widths = new double[walk.ids.length];
+
+                /* Text is measured with the default font at 10pt, which
+                 * is what draw() uses */
+                Cairo.ImageSurface s = new Cairo.ImageSurface(Cairo.Format.ARGB32, 1, 1);
+                Cairo.Context cr = new Cairo.Context(s);
+                cr.set_font_size(10);
+
+                for (int i = 0; i < walk.ids.length; i++) {
+                        int d = walk.depths[i];
+
+                        while (rows.length <= d)
+                                rows += 0;
+
+                        Cairo.TextExtents e;
+                        cr.text_extents(walk.ids[i], out e);
+
+                        xs[i] = d * COLUMN_WIDTH;
+                        ys[i] = rows[d] * ROW_HEIGHT;
+                        rows[d] = rows[d] + 1;
+                        widths[i] = double.min(e.x_advance + 12, COLUMN_WIDTH - 40);
+                }
+        }
+
+        private int node_at(double x, double y) {
+                double gx = (x - offset_x) / scale;
+                double gy = (y - offset_y) / scale;
+
+                for (int i = 0; i < xs.length; i++)
+                        if (gx >= xs[i] && gx <= xs[i] + widths[i] &&
+                            gy >= ys[i] && gy <= ys[i] + NODE_HEIGHT)
+                                return i;
+
+                return -1;
+        }
+
+        private static void set_edge_color(Cairo.Context cr, int type) {
+                switch (type) {
+                case DependencyType.REQUIRES:
+                        cr.set_source_rgb(0.1, 0.1, 0.1);
+                        break;
+                case DependencyType.WANTS:
+                        cr.set_source_rgb(0.55, 0.55, 0.55);
+                        break;
+                case DependencyType.CONFLICTS:
+                        cr.set_source_rgb(0.8, 0.1, 0.1);
+                        break;
+                default:
+                        cr.set_source_rgb(0.2, 0.4, 0.8);
+                        break;
+                }
+        }
+
+        public override bool draw(Cairo.Context cr) {
+                if (dirty)
+                        layout_nodes();
+
+                cr.set_source_rgb(1, 1, 1);
+                cr.paint();
+
+                if (walk == null)
+                        return true;
+
+                cr.translate(offset_x, offset_y);
+                cr.scale(scale, scale);
+                cr.set_line_width(1);
+                cr.set_font_size(10);
+
+                /* Edges between the nodes shown, by type */
+                Gee.HashMap<string, int> index = new Gee.HashMap<string, int>();
+                for (int i = 0; i < walk.ids.length; i++)
+                        index[walk.ids[i]] = i;
+
+                for (int t = 0; t < DEPENDENCY_PROPERTIES.length; t++) {
+                        if ((mask & (1 << t)) == 0)
+                                continue;
+
+                        set_edge_color(cr, t);
+
+                        for (int i = 0; i < walk.ids.length; i++) {
+                                foreach (string target in graph.get_edges(walk.ids[i], 1 << t, reverse)) {
+                                        if (!index.has_key(target))
+                                                continue;
+
+                                        int j = index[target];
+                                        cr.move_to(xs[i] + widths[i], ys[i] + NODE_HEIGHT / 2);
+                                        cr.line_to(xs[j], ys[j] + NODE_HEIGHT / 2);
+                                }
+                        }
+
+                        cr.stroke();
+                }
+
+                /* Nodes, skipping those outside the clip */
+                double x1, y1, x2, y2;
+                cr.clip_extents(out x1, out y1, out x2, out y2);
+
+                for (int i = 0; i < walk.ids.length; i++) {
+                        if (xs[i] > x2 || xs[i] + widths[i] < x1 ||
+                            ys[i] > y2 || ys[i] + NODE_HEIGHT < y1)
+                                continue;
+
+                        cr.rectangle(xs[i], ys[i], widths[i], NODE_HEIGHT);
+                        if (i == 0)
+                                cr.set_source_rgb(1.0, 0.95, 0.7);
+                        else
+                                cr.set_source_rgb(0.93, 0.95, 1.0);
+                        cr.fill_preserve();
+                        cr.set_source_rgb(0.3, 0.3, 0.3);
+                        cr.stroke();
+
+                        cr.save();
+                        cr.rectangle(xs[i], ys[i], widths[i], NODE_HEIGHT);
+                        cr.clip();
+                        cr.move_to(xs[i] + 6, ys[i] + 14);
+                        cr.set_source_rgb(0, 0, 0);
+                        cr.show_text(walk.ids[i]);
+                        cr.restore();
+                }
+
+                return true;
+        }
+
+        public override bool scroll_event(Gdk.EventScroll event) {
+                double factor;
+
+                if (event.direction == Gdk.ScrollDirection.UP)
+                        factor = 1.25;
+                else if (event.direction == Gdk.ScrollDirection.DOWN)
+                        factor = 0.8;
+                else
+                        return false;
+
+                double s = (scale * factor).clamp(0.05, 8.0);
+
+                /* Keep the point under the pointer where it is */
+                offset_x = event.x - (event.x - offset_x) * s / scale;
+                offset_y = event.y - (event.y - offset_y) * s / scale;
+                scale = s;
+
+                queue_draw();
+                return true;
+        }
+
+        public override bool button_press_event(Gdk.EventButton event) {
+                if (event.button != 1)
+                        return false;
+
+                if (event.type == Gdk.EventType.DOUBLE_BUTTON_PRESS) {
+                        /* The boxes have to match the walk they index */
+                        if (get_walk() == null)
+                                return true;
+
+                        int i = node_at(event.x, event.y);
+
+                        if (i > 0) {
+                                string id = walk.ids[i];
+                                show_root(id, mask, reverse);
+                                unit_activated(id);
+                        }
+
+                        return true;
+                }
+
+                dragging = true;
+                drag_x = event.x;
+                drag_y = event.y;
+                return true;
+        }
+
+        public override bool button_release_event(Gdk.EventButton event) {
+                if (event.button == 1)
+                        dragging = false;
+
+                return true;
+        }
+
+        public override bool motion_notify_event(Gdk.EventMotion event) {
+                if (!dragging)
+                        return false;
+
+                offset_x += event.x - drag_x;
+                offset_y += event.y - drag_y;
+                drag_x = event.x;
+                drag_y = event.y;
+
+                queue_draw();
+                return true;
+        }
+}
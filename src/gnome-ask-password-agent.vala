@@ -22,9 +22,6 @@ using GLib;
 using Posix;
 using Notify;
 
-[CCode (cheader_filename = "time.h")]
-extern int clock_gettime(int id, out timespec ts);
-
 public class PasswordDialog : Dialog {
 
         public Entry entry;
@@ -68,130 +65,143 @@ public class PasswordDialog : Dialog {
         }
 }
 
+/* Only created once a request has to be shown, see PasswordAgent */
 public class MyStatusIcon : StatusIcon {
 
-        File directory;
-        File current;
-        FileMonitor file_monitor;
+        PasswordRequestIndex requests;
 
-        string message;
-        string icon;
-        string socket;
+        /* The request the icon, the notification and the dialog are
+         * about, the head of the queue unless the dialog is open */
+        PasswordRequest? current;
 
         PasswordDialog password_dialog;
         Notify.Notification n;
 
-        public MyStatusIcon() throws GLib.Error {
+        /* A dialog was closed, the queue may look different now */
+        public signal void answered();
+
+        public MyStatusIcon(PasswordRequestIndex requests) {
                 GLib.Object(icon_name : "dialog-password");
                 set_title("System Password Request");
 
-                directory = File.new_for_path("/run/systemd/ask-password/");
-                file_monitor = directory.monitor_directory(0);
-                file_monitor.changed.connect(file_monitor_changed);
-
+                this.requests = requests;
                 current = null;
-                look_for_password();
 
                 activate.connect(status_icon_activate);
+                popup_menu.connect(status_icon_popup_menu);
         }
 
-        void file_monitor_changed(GLib.File file, GLib.File? other_file, GLib.FileMonitorEvent event_type) {
-
-                if (!file.get_basename().has_prefix("ask."))
-                        return;
+        public void update_current() {
+                Gee.List<PasswordRequest> queue = requests.get_queue();
 
-                if (event_type == FileMonitorEvent.CREATED ||
-                    event_type == FileMonitorEvent.DELETED) {
-                        try {
-                                look_for_password();
-                        } catch (Error e) {
-                                show_error(e.message);
-                        }
+                if (current != null && !requests.contains(current)) {
+                        if (password_dialog != null)
+                                password_dialog.response(ResponseType.REJECT);
+                        current = null;
                 }
-        }
 
-        void look_for_password() throws GLib.Error {
+                /* Stay with the request being answered */
+                if (password_dialog == null) {
+                        PasswordRequest? head = queue.size > 0 ? queue[0] : null;
 
-                if (current != null) {
-                        if (!current.query_exists()) {
-                                current = null;
-                                if (password_dialog != null)
-                                        password_dialog.response(ResponseType.REJECT);
+                        if (head != current) {
+                                current = head;
+                                if (current != null)
+                                        notify_current();
                         }
                 }
 
                 if (current == null) {
-                        FileEnumerator enumerator = directory.enumerate_children("standard::name", FileQueryInfoFlags.NOFOLLOW_SYMLINKS);
+                        close_notification();
+                        set_visible(false);
+                        return;
+                }
 
-                        FileInfo i;
-                        while ((i = enumerator.next_file()) != null) {
-                                if (!i.get_name().has_prefix("ask."))
-                                        continue;
+                set_from_icon_name(current.icon);
 
-                                current = directory.get_child(i.get_name());
+                if (queue.size > 1)
+                        set_tooltip_text("%s (%d more pending)".printf(current.message, queue.size - 1));
+                else
+                        set_tooltip_text(current.message);
+        }
 
-                                if (load_password())
-                                        break;
+        /* Withdraws the notification of a request that went away */
+        void close_notification() {
+                if (n == null)
+                        return;
 
-                                current = null;
-                        }
+                try {
+                        n.close();
+                } catch (GLib.Error e) {
                 }
 
-                if (current == null)
-                        set_visible(false);
+                n = null;
         }
 
-        bool load_password() throws GLib.Error {
+        void notify_current() {
+                close_notification();
 
-                KeyFile key_file = new KeyFile();
+                n = new Notify.Notification(title, current.message, current.icon);
+                n.set_timeout(5000);
+                n.closed.connect(() => {
+                        if (current != null)
+                                set_visible(true);
+                });
+                n.add_action("enter_pw", "Enter password", status_icon_activate);
 
                 try {
-                        timespec ts;
-
-                        key_file.load_from_file(current.get_path(), KeyFileFlags.NONE);
-
-                        string not_after_as_string = key_file.get_string("Ask", "NotAfter");
+                        n.show();
+                } catch (GLib.Error e) {
+                        set_visible(true);
+                }
+        }
 
-                        clock_gettime(1, out ts);
-                        uint64 now = (ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+        /* The sockets of system requests are only writable by root */
+        void reply_privileged(PasswordRequest r, bool ok, string password) throws Error {
+                Pid child_pid;
+                int to_process;
 
-                        uint64 not_after = uint64.parse(not_after_as_string);;
-                        if ((not_after == 0 && GLib.errno == Posix.EINVAL) ||
-                            (not_after == int64.MAX && GLib.errno == Posix.ERANGE))
-                                return false;
+                Process.spawn_async_with_pipes(
+                                null,
+                                { "/usr/bin/pkexec", "/lib/systemd/systemd-reply-password", ok ? "1" : "0", r.socket },
+                                null,
+                                SpawnFlags.DO_NOT_REAP_CHILD,
+                                null,
+                                out child_pid,
+                                out to_process,
+                                null,
+                                null);
+                ChildWatch.add(child_pid, (pid, status) => {
+                        Process.close_pid(pid);
+                });
 
-                        if (not_after > 0 && not_after < now)
-                                return false;
+                OutputStream stream = new UnixOutputStream(to_process, true);
+                stream.write(password.data, null);
+        }
 
-                        socket = key_file.get_string("Ask", "Socket");
-                } catch (GLib.Error e) {
-                        return false;
-                }
+        /* User requests are ours, the reply goes to the socket directly
+         * in the format systemd-reply-password uses */
+        void reply(PasswordRequest r, bool ok, string password) throws Error {
+                GLib.Socket socket = new GLib.Socket(SocketFamily.UNIX, SocketType.DATAGRAM, SocketProtocol.DEFAULT);
 
-                try {
-                        message = key_file.get_string("Ask", "Message").compress();
-                } catch (GLib.Error e) {
-                        message = "Please Enter System Password!";
-                }
+                socket.send_to(new UnixSocketAddress(r.socket), (ok ? "+" + password : "-").data);
+                socket.close();
+        }
 
-                set_tooltip_text(message);
+        /* All pending requests, in queue order */
+        void status_icon_popup_menu(uint button, uint activate_time) {
+                Gtk.Menu menu = new Gtk.Menu();
 
-                try {
-                        icon = key_file.get_string("Ask", "Icon");
-                } catch (GLib.Error e) {
-                        icon = "dialog-password";
+                foreach (PasswordRequest r in requests.get_queue()) {
+                        Gtk.MenuItem item = new Gtk.MenuItem.with_label(r.message);
+                        item.activate.connect(() => {
+                                answer(r);
+                        });
+                        menu.append(item);
                 }
-                set_from_icon_name(icon);
 
-                n = new Notify.Notification(title, message, icon);
-                n.set_timeout(5000);
-                n.closed.connect(() => {
-                        set_visible(true);
-                });
-                n.add_action("enter_pw", "Enter password", status_icon_activate);
-                n.show();
-
-                return true;
+                menu.show_all();
+                menu.popup(null, null, null, button, activate_time);
         }
 
         void status_icon_activate() {
@@ -199,12 +209,23 @@ public class MyStatusIcon : StatusIcon {
                 if (current == null)
                         return;
 
+                answer(current);
+        }
+
+        void answer(PasswordRequest r) {
+
                 if (password_dialog != null) {
                         password_dialog.present();
                         return;
                 }
 
-                password_dialog = new PasswordDialog(message, icon);
+                if (!requests.contains(r))
+                        return;
+
+                password_dialog = new PasswordDialog(r.message, r.icon);
+
+                current = r;
+                update_current();
 
                 int result = password_dialog.run();
                 string password = password_dialog.entry.get_text();
@@ -214,32 +235,209 @@ public class MyStatusIcon : StatusIcon {
 
                 if (result == ResponseType.REJECT ||
                     result == ResponseType.DELETE_EVENT ||
-                    result == ResponseType.CANCEL)
+                    result == ResponseType.CANCEL) {
+                        answered();
                         return;
+                }
 
-                Pid child_pid;
-                int to_process;
+                try {
+                        if (Path.get_dirname(r.path) == PasswordAgent.SYSTEM_DIRECTORY)
+                                reply_privileged(r, result == ResponseType.OK, password);
+                        else
+                                reply(r, result == ResponseType.OK, password);
+                } catch (Error e) {
+                        show_error(e.message);
+                }
+
+                /* The file goes away once the reply is read, the next
+                 * request is picked up then */
+                answered();
+        }
+}
+
+/* Everything that works without a display: the index, the watch and the
+ * timers. GTK and libnotify are only initialised, and the status icon
+ * created, for the first request that has to be shown. */
+public class PasswordAgent : Object {
+
+        public const string SYSTEM_DIRECTORY = "/run/systemd/ask-password";
+
+        /* Seconds without pending requests before we exit, the .path
+         * unit starts us again for the next one. It does so as long as
+         * a directory is not empty, so we only exit once they all are. */
+        const uint IDLE_TIMEOUT = 30;
+
+        MainLoop loop;
+        AskPasswordWatch watch;
+        PasswordRequestIndex requests;
+        MyStatusIcon? status_icon;
+
+        /* The system directory and the user manager's one, both go
+         * into the same index and queue */
+        string[] directories = {};
+
+        /* Fires at the earliest NotAfter of all requests, GLib timeouts
+         * run on the monotonic clock like NotAfter does */
+        uint expiry_timeout;
+        uint64 expiry;
+
+        uint idle_timeout;
+
+        public PasswordAgent(MainLoop loop) throws GLib.Error {
+                this.loop = loop;
+
+                requests = new PasswordRequestIndex();
+
+                /* Set up before the scan, so nothing falls in between */
+                watch = new AskPasswordWatch();
+                watch.add_directory(SYSTEM_DIRECTORY);
+                directories += SYSTEM_DIRECTORY;
+                requests.scan(SYSTEM_DIRECTORY);
+
+                /* Optional, the system directory is what matters */
+                string user_directory = Path.build_filename(Environment.get_user_runtime_dir(), "systemd", "ask-password");
 
                 try {
-                        Process.spawn_async_with_pipes(
-                                        null,
-                                        { "/usr/bin/pkexec", "/lib/systemd/systemd-reply-password", result == ResponseType.OK ? "1" : "0", socket },
-                                        null,
-                                        SpawnFlags.DO_NOT_REAP_CHILD,
-                                        null,
-                                        out child_pid,
-                                        out to_process,
-                                        null,
-                                        null);
-                        ChildWatch.add(child_pid, (pid, status) => {
-                                Process.close_pid(pid);
+                        if (DirUtils.create_with_parents(user_directory, 0755) < 0)
+                                throw new IOError.FAILED("Failed to create %s: %s", user_directory, Posix.strerror(GLib.errno));
+
+                        watch.add_directory(user_directory);
+                        directories += user_directory;
+                        requests.scan(user_directory);
+                } catch (GLib.Error e) {
+                        Posix.stderr.printf("%s\n", e.message);
+                }
+
+                watch.file_changed.connect(on_file_changed);
+                watch.file_removed.connect(on_file_removed);
+                watch.overflow.connect(on_overflow);
+
+                status_icon = null;
+                expiry_timeout = 0;
+                expiry = 0;
+                idle_timeout = 0;
+
+                /* From the main loop, a quit() before run() would be
+                 * lost */
+                Idle.add(() => {
+                        update();
+                        return false;
+                });
+        }
+
+        /* Only the file the event is about is looked at, the index
+         * skips it if inode and mtime did not change */
+        void on_file_changed(string path) {
+                if (!Path.get_basename(path).has_prefix("ask."))
+                        return;
+
+                if (requests.update(path))
+                        update();
+        }
+
+        void on_file_removed(string path) {
+                if (!Path.get_basename(path).has_prefix("ask."))
+                        return;
+
+                if (requests.remove(path))
+                        update();
+        }
+
+        void on_overflow() {
+                foreach (string d in directories) {
+                        try {
+                                requests.scan(d);
+                        } catch (GLib.Error e) {
+                                Posix.stderr.printf("%s\n", e.message);
+                        }
+                }
+
+                update();
+        }
+
+        void update() {
+                bool pending = requests.get_queue().size > 0;
+
+                arm_expiry_timeout();
+
+                if (pending && status_icon == null) {
+                        if (!Gtk.init_check(ref gtk_args)) {
+                                Posix.stderr.printf("Failed to open the display.\n");
+                                loop.quit();
+                                return;
+                        }
+
+                        Notify.init("Password Agent");
+
+                        status_icon = new MyStatusIcon(requests);
+                        status_icon.answered.connect(update);
+                }
+
+                if (status_icon != null)
+                        status_icon.update_current();
+
+                if (pending) {
+                        if (idle_timeout != 0) {
+                                Source.remove(idle_timeout);
+                                idle_timeout = 0;
+                        }
+                } else if (idle_timeout == 0)
+                        idle_timeout = Timeout.add_seconds(IDLE_TIMEOUT, () => {
+                                /* Stale or unparsable files, or sockets
+                                 * left behind, would start us right away
+                                 * again. Look again later instead. */
+                                if (!directories_empty())
+                                        return true;
+
+                                idle_timeout = 0;
+                                loop.quit();
+                                return false;
                         });
+        }
 
-                        OutputStream stream = new UnixOutputStream(to_process, true);
-                        stream.write(password.data, null);
-                } catch (Error e) {
-                        show_error(e.message);
+        bool directories_empty() {
+                foreach (string d in directories) {
+                        try {
+                                if (Dir.open(d).read_name() != null)
+                                        return false;
+                        } catch (FileError e) {
+                                /* Gone, the .path unit will not trigger
+                                 * on it either */
+                        }
+                }
+
+                return true;
+        }
+
+        /* Re-armed whenever the set of requests changes, only if the
+         * earliest NotAfter moved */
+        void arm_expiry_timeout() {
+                uint64 next = requests.next_expiry();
+
+                if (next == expiry)
+                        return;
+
+                if (expiry_timeout != 0) {
+                        Source.remove(expiry_timeout);
+                        expiry_timeout = 0;
                 }
+
+                expiry = next;
+                if (next == 0)
+                        return;
+
+                /* Rounded up, so the request has expired when we look.
+                 * It may have expired since next_expiry() already. */
+                uint64 now = monotonic_usec();
+                uint64 msec = next <= now ? 0 : (next - now) / 1000 + 1;
+                uint interval = (uint) uint64.min(msec, uint.MAX);
+
+                expiry_timeout = Timeout.add(interval, () => {
+                        expiry_timeout = 0;
+                        expiry = 0;
+                        update();
+                        return false;
+                });
         }
 }
 
@@ -254,15 +452,31 @@ void show_error(string e) {
         m.destroy();
 }
 
+/* Kept for Gtk.init_check(), which only runs once a request has to be
+ * shown */
+static string[] gtk_args;
+
 int main(string[] args) {
+        OptionContext context = new OptionContext("[OPTION...]");
+        context.add_main_entries(entries, "systemd-ask-password-agent");
+
+        /* The GTK options are left for GTK */
+        context.set_ignore_unknown_options(true);
+
         try {
-                Gtk.init_with_args(ref args, "[OPTION...]", entries, "systemd-ask-password-agent");
-                Notify.init("Password Agent");
+                context.parse(ref args);
+        } catch (OptionError e) {
+                Posix.stderr.printf("%s\n", e.message);
+                return 1;
+        }
+
+        gtk_args = args;
 
-                MyStatusIcon i = new MyStatusIcon();
-                Gtk.main();
-        } catch (IOError e) {
-                show_error(e.message);
+        MainLoop loop = new MainLoop();
+
+        try {
+                PasswordAgent agent = new PasswordAgent(loop);
+                loop.run();
         } catch (GLib.Error e) {
                 Posix.stderr.printf("%s\n", e.message);
         }
@@ -0,0 +1,219 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+using GLib;
+
+[CCode (cheader_filename = "time.h")]
+extern int clock_gettime(int id, out Posix.timespec ts);
+
+/* CLOCK_MONOTONIC in usec, the clock NotAfter is given in */
+public uint64 monotonic_usec() {
+        Posix.timespec ts;
+
+        clock_gettime(1, out ts);
+        return ((uint64) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/* One ask.* file. What was parsed out of it is kept for as long as the
+ * inode and mtime stay the same. Files that do not parse are kept as
+ * well, so that they are not parsed again until they change. */
+public class PasswordRequest {
+
+        public string path;
+        public uint64 inode;
+        public uint64 mtime;
+
+        public bool valid;
+        public uint64 not_after;
+        public string socket;
+        public string message;
+        public string icon;
+
+        public PasswordRequest(string path) {
+                this.path = path;
+        }
+
+        public void load() {
+                KeyFile key_file = new KeyFile();
+
+                valid = false;
+
+                try {
+                        key_file.load_from_file(path, KeyFileFlags.NONE);
+
+                        not_after = key_file.get_uint64("Ask", "NotAfter");
+                        socket = key_file.get_string("Ask", "Socket");
+                } catch (GLib.Error e) {
+                        return;
+                }
+
+                try {
+                        message = key_file.get_string("Ask", "Message").compress();
+                } catch (GLib.Error e) {
+                        message = "Please Enter System Password!";
+                }
+
+                try {
+                        icon = key_file.get_string("Ask", "Icon");
+                } catch (GLib.Error e) {
+                        icon = "dialog-password";
+                }
+
+                valid = true;
+        }
+
+        public bool is_expired(uint64 now) {
+                return not_after > 0 && not_after < now;
+        }
+}
+
+/* The pending requests by path. The directories are enumerated once,
+ * after that file events update single entries. */
+public class PasswordRequestIndex {
+
+        private const string ATTRIBUTES = "unix::inode,time::modified,time::modified-usec";
+
+        private Gee.HashMap<string, PasswordRequest> requests;
+
+        public PasswordRequestIndex() {
+                requests = new Gee.HashMap<string, PasswordRequest>();
+        }
+
+        private bool update_from_info(string path, FileInfo info) {
+                uint64 inode = info.get_attribute_uint64("unix::inode");
+                uint64 mtime = info.get_attribute_uint64("time::modified") * 1000000 +
+                               info.get_attribute_uint32("time::modified-usec");
+
+                PasswordRequest? r = requests[path];
+
+                if (r != null && r.inode == inode && r.mtime == mtime)
+                        return false;
+
+                if (r == null) {
+                        r = new PasswordRequest(path);
+                        requests[path] = r;
+                }
+
+                bool was_valid = r.valid;
+
+                r.inode = inode;
+                r.mtime = mtime;
+                r.load();
+
+                return r.valid || was_valid;
+        }
+
+        /* Brings the entry for path up to date. Returns true if the
+         * queue may look different now. */
+        public bool update(string path) {
+                FileInfo info;
+
+                try {
+                        info = File.new_for_path(path).query_info(ATTRIBUTES, FileQueryInfoFlags.NOFOLLOW_SYMLINKS);
+                } catch (GLib.Error e) {
+                        return remove(path);
+                }
+
+                return update_from_info(path, info);
+        }
+
+        public bool remove(string path) {
+                PasswordRequest r;
+
+                if (!requests.unset(path, out r))
+                        return false;
+
+                return r.valid;
+        }
+
+        /* Adds what is in directory and drops what is no longer there */
+        public bool scan(string directory) throws GLib.Error {
+                FileEnumerator enumerator = File.new_for_path(directory).enumerate_children(
+                                "standard::name," + ATTRIBUTES, FileQueryInfoFlags.NOFOLLOW_SYMLINKS);
+                Gee.HashSet<string> seen = new Gee.HashSet<string>();
+                bool changed = false;
+                FileInfo i;
+
+                while ((i = enumerator.next_file()) != null) {
+                        if (!i.get_name().has_prefix("ask."))
+                                continue;
+
+                        string path = Path.build_filename(directory, i.get_name());
+
+                        seen.add(path);
+                        if (update_from_info(path, i))
+                                changed = true;
+                }
+
+                Gee.ArrayList<string> gone = new Gee.ArrayList<string>();
+
+                foreach (string path in requests.keys)
+                        if (Path.get_dirname(path) == directory && !(path in seen))
+                                gone.add(path);
+
+                foreach (string path in gone)
+                        if (remove(path))
+                                changed = true;
+
+                return changed;
+        }
+
+        /* False once the request was answered, withdrawn, rewritten
+         * into something invalid or has expired */
+        public bool contains(PasswordRequest r) {
+                return r.valid && !r.is_expired(monotonic_usec()) && requests[r.path] == r;
+        }
+
+        /* The earliest NotAfter still ahead, 0 if nothing expires */
+        public uint64 next_expiry() {
+                uint64 now = monotonic_usec();
+                uint64 next = 0;
+
+                foreach (PasswordRequest r in requests.values)
+                        if (r.valid && r.not_after > 0 && !r.is_expired(now) &&
+                            (next == 0 || r.not_after < next))
+                                next = r.not_after;
+
+                return next;
+        }
+
+        /* The valid requests that have not expired yet, the one that
+         * expires first at the head. Requests without NotAfter come
+         * last, oldest first. */
+        public Gee.List<PasswordRequest> get_queue() {
+                Gee.ArrayList<PasswordRequest> queue = new Gee.ArrayList<PasswordRequest>();
+                uint64 now = monotonic_usec();
+
+                foreach (PasswordRequest r in requests.values)
+                        if (r.valid && !r.is_expired(now))
+                                queue.add(r);
+
+                queue.sort((a, b) => {
+                        uint64 x = a.not_after > 0 ? a.not_after : uint64.MAX;
+                        uint64 y = b.not_after > 0 ? b.not_after : uint64.MAX;
+
+                        if (x != y)
+                                return x < y ? -1 : 1;
+                        if (a.mtime != b.mtime)
+                                return a.mtime < b.mtime ? -1 : 1;
+
+                        return strcmp(a.path, b.path);
+                });
+
+                return queue;
+        }
+}
@@ -0,0 +1,466 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+using Gtk;
+using GLib;
+
+public enum RestartResult {
+        PENDING,
+        RESTARTING,
+        HEALTHY,
+        TIMED_OUT,
+        FAILED,
+        SKIPPED
+}
+
+/* One unit of a rolling restart that is currently in flight */
+public class RestartSlot {
+        public int index;
+        public string path;
+        public string? job = null;
+        public string active_state = "";
+        public string sub_state = "";
+        public uint timeout = 0;
+        public uint subscription = 0;
+        public bool done = false;
+
+        public RestartSlot(int index, string path) {
+                this.index = index;
+                this.path = path;
+        }
+}
+
+/* Restarts a list of units with at most concurrency of them in flight.
+ * A unit holds its slot until it is active and running again, failed,
+ * or the timeout passed, so a new unit is only started once an earlier
+ * one is healthy or given up on. Once more than max_failures units
+ * failed no new ones are started. Everything runs from the main loop. */
+public class RollingRestart : Object {
+
+        public int concurrency { get; construct; }
+        public uint timeout_seconds { get; construct; }
+        public int max_failures { get; construct; }
+
+        public string[] paths;
+        public RestartResult[] results;
+
+        public int healthy = 0;
+        public int timed_out = 0;
+        public int failed = 0;
+        public bool aborted = false;
+
+        private DBusConnection bus;
+        private Manager manager;
+        private Cancellable cancellable;
+
+        private int next = 0;
+        private HashTable<string, RestartSlot> slots_by_job;
+        private Gee.HashSet<RestartSlot> slots;
+        private ulong job_removed_handler = 0;
+
+        public signal void unit_changed(int index);
+        public signal void finished();
+
+        public RollingRestart(DBusConnection bus, Manager manager,
+                              string[] paths,
+                              int concurrency, uint timeout_seconds, int max_failures) {
+                Object(concurrency: concurrency, timeout_seconds: timeout_seconds, max_failures: max_failures);
+
+                this.bus = bus;
+                this.manager = manager;
+                this.paths = paths;
+
+                results = new RestartResult[paths.length];
+                for (int i = 0; i < results.length; i++)
+                        results[i] = RestartResult.PENDING;
+
+                cancellable = new Cancellable();
+                slots_by_job = new HashTable<string, RestartSlot>(str_hash, str_equal);
+                slots = new Gee.HashSet<RestartSlot>();
+        }
+
+        public int get_done() {
+                return healthy + timed_out + failed;
+        }
+
+        public bool is_running() {
+                return job_removed_handler != 0;
+        }
+
+        public void start() {
+                job_removed_handler = manager.job_removed.connect(on_job_removed);
+                fill_slots();
+        }
+
+        /* Stops starting new units and gives up on those in flight, the
+         * jobs systemd already has stay queued */
+        public void abort() {
+                aborted = true;
+                cancellable.cancel();
+
+                foreach (RestartSlot s in slots.to_array())
+                        finish(s, RestartResult.SKIPPED);
+
+                check_finished();
+        }
+
+        private void fill_slots() {
+                while (!aborted && slots.size < concurrency && next < paths.length) {
+                        RestartSlot s = new RestartSlot(next, paths[next]);
+                        next++;
+                        slots.add(s);
+                        restart.begin(s);
+                }
+
+                check_finished();
+        }
+
+        private void check_finished() {
+                if (slots.size > 0 || (!aborted && next < paths.length))
+                        return;
+
+                if (job_removed_handler == 0)
+                        return;
+
+                SignalHandler.disconnect(manager, job_removed_handler);
+                job_removed_handler = 0;
+
+                for (int i = next; i < paths.length; i++) {
+                        results[i] = RestartResult.SKIPPED;
+                        unit_changed(i);
+                }
+
+                finished();
+        }
+
+        private void set_result(RestartSlot s, RestartResult r) {
+                results[s.index] = r;
+                unit_changed(s.index);
+        }
+
+        private void finish(RestartSlot s, RestartResult r) {
+                if (s.done)
+                        return;
+
+                s.done = true;
+
+                if (s.timeout != 0)
+                        Source.remove(s.timeout);
+                if (s.subscription != 0)
+                        bus.signal_unsubscribe(s.subscription);
+                if (s.job != null)
+                        slots_by_job.remove(s.job);
+                slots.remove(s);
+
+                switch (r) {
+                case RestartResult.HEALTHY:
+                        healthy++;
+                        break;
+                case RestartResult.TIMED_OUT:
+                        timed_out++;
+                        break;
+                case RestartResult.FAILED:
+                        failed++;
+                        break;
+                default:
+                        break;
+                }
+
+                set_result(s, r);
+
+                if (failed > max_failures)
+                        aborted = true;
+
+                if (!aborted)
+                        fill_slots();
+                else
+                        check_finished();
+        }
+
+        /* The job is done, but the unit counts as healthy only once it
+         * is active and running */
+        private void check_health(RestartSlot s) {
+                if (s.active_state == "failed")
+                        finish(s, RestartResult.FAILED);
+                else if (s.active_state == "active" && s.sub_state == "running")
+                        finish(s, RestartResult.HEALTHY);
+        }
+
+        private void on_properties_changed(DBusConnection connection, string? sender_name, string object_path, string interface_name, string signal_name, Variant parameters) {
+                RestartSlot? s = null;
+
+                foreach (RestartSlot i in slots)
+                        if (i.path == object_path) {
+                                s = i;
+                                break;
+                        }
+
+                if (s == null)
+                        return;
+
+                Variant changed = parameters.get_child_value(1);
+                Variant? v;
+
+                v = changed.lookup_value("ActiveState", VariantType.STRING);
+                if (v != null)
+                        s.active_state = v.get_string();
+
+                v = changed.lookup_value("SubState", VariantType.STRING);
+                if (v != null)
+                        s.sub_state = v.get_string();
+
+                /* Until the job is gone the unit passes through states
+                 * that mean nothing yet */
+                if (s.job != null && !slots_by_job.contains(s.job))
+                        check_health(s);
+        }
+
+        private void on_job_removed(uint32 id, ObjectPath path, string res) {
+                RestartSlot? s = slots_by_job[path];
+
+                if (s == null)
+                        return;
+
+                slots_by_job.remove(path);
+
+                if (res != "done") {
+                        finish(s, RestartResult.FAILED);
+                        return;
+                }
+
+                fetch_state.begin(s);
+        }
+
+        private async void fetch_state(RestartSlot s) {
+                try {
+                        Variant reply = yield bus.call(
+                                        "org.freedesktop.systemd1",
+                                        s.path,
+                                        "org.freedesktop.DBus.Properties",
+                                        "GetAll",
+                                        new Variant("(s)", "org.freedesktop.systemd1.Unit"),
+                                        new VariantType("(a{sv})"),
+                                        DBusCallFlags.NONE,
+                                        -1,
+                                        cancellable);
+
+                        Variant properties = reply.get_child_value(0);
+                        Variant? v;
+
+                        v = properties.lookup_value("ActiveState", VariantType.STRING);
+                        if (v != null)
+                                s.active_state = v.get_string();
+
+                        v = properties.lookup_value("SubState", VariantType.STRING);
+                        if (v != null)
+                                s.sub_state = v.get_string();
+
+                        if (!s.done)
+                                check_health(s);
+                } catch (Error e) {
+                        /* Aborted, or the unit went away */
+                        if (!s.done)
+                                finish(s, RestartResult.FAILED);
+                }
+        }
+
+        private async void restart(RestartSlot s) {
+                set_result(s, RestartResult.RESTARTING);
+
+                /* Subscribed before the restart so that no state change
+                 * is missed */
+                s.subscription = bus.signal_subscribe(
+                                "org.freedesktop.systemd1",
+                                "org.freedesktop.DBus.Properties",
+                                "PropertiesChanged",
+                                s.path,
+                                "org.freedesktop.systemd1.Unit",
+                                DBusSignalFlags.NONE,
+                                on_properties_changed);
+
+                s.timeout = Timeout.add_seconds(timeout_seconds, () => {
+                        s.timeout = 0;
+                        finish(s, RestartResult.TIMED_OUT);
+                        return false;
+                });
+
+                try {
+                        Unit u = yield bus.get_proxy(
+                                        "org.freedesktop.systemd1",
+                                        s.path,
+                                        DBusProxyFlags.DO_NOT_LOAD_PROPERTIES | DBusProxyFlags.DO_NOT_CONNECT_SIGNALS,
+                                        cancellable);
+
+                        string job = yield u.restart("replace", cancellable);
+
+                        if (s.done)
+                                return;
+
+                        s.job = job;
+                        slots_by_job[job] = s;
+                } catch (Error e) {
+                        if (!s.done)
+                                finish(s, RestartResult.FAILED);
+                }
+        }
+}
+
+/* Asks for the parameters of a rolling restart and shows its progress */
+public class RollingRestartDialog : Dialog {
+
+        private DBusConnection bus;
+        private Manager manager;
+        private string[] ids;
+        private string[] paths;
+
+        private RollingRestart? engine = null;
+
+        private SpinButton concurrency_spin;
+        private SpinButton timeout_spin;
+        private SpinButton failures_spin;
+        private ProgressBar progress_bar;
+        private Label summary_label;
+        private Gtk.ListStore unit_store;
+        private Button start_button;
+        private Button abort_button;
+
+        public RollingRestartDialog(Window parent, DBusConnection bus, Manager manager, string[] ids, string[] paths) {
+                this.bus = bus;
+                this.manager = manager;
+                this.ids = ids;
+                this.paths = paths;
+
+                title = "Rolling Restart";
+                set_transient_for(parent);
+                set_default_size(500, 500);
+                set_border_width(12);
+
+                Box content = get_content_area();
+                content.set_spacing(12);
+
+                Grid grid = new Grid();
+                grid.column_spacing = 6;
+                grid.row_spacing = 6;
+                content.pack_start(grid, false, false, 0);
+
+                concurrency_spin = new SpinButton.with_range(1, 64, 1);
+                concurrency_spin.set_value(4);
+                timeout_spin = new SpinButton.with_range(1, 3600, 1);
+                timeout_spin.set_value(60);
+                failures_spin = new SpinButton.with_range(0, paths.length, 1);
+                failures_spin.set_value(0);
+
+                grid.attach(new LeftLabel("Units at once:"),              0, 0, 1, 1);
+                grid.attach(concurrency_spin,                              1, 0, 1, 1);
+                grid.attach(new LeftLabel("Health timeout (s):"),         0, 1, 1, 1);
+                grid.attach(timeout_spin,                                  1, 1, 1, 1);
+                grid.attach(new LeftLabel("Abort after failures:"),       0, 2, 1, 1);
+                grid.attach(failures_spin,                                 1, 2, 1, 1);
+
+                progress_bar = new ProgressBar();
+                progress_bar.set_show_text(true);
+                content.pack_start(progress_bar, false, false, 0);
+
+                summary_label = new Label("%d units".printf(paths.length));
+                summary_label.halign = Align.START;
+                content.pack_start(summary_label, false, false, 0);
+
+                unit_store = new Gtk.ListStore(2, typeof(string), typeof(string));
+                foreach (string id in ids) {
+                        TreeIter iter;
+                        unit_store.append(out iter);
+                        unit_store.set(iter, 0, id, 1, "pending");
+                }
+
+                TreeView view = new TreeView.with_model(unit_store);
+                new_column(view, 0, "Unit");
+                new_column(view, 1, "State");
+                content.pack_start(new_scrolled_window(view), true, true, 0);
+
+                start_button = (Button) add_button("_Start", 1);
+                abort_button = (Button) add_button("_Abort", 2);
+                add_button("_Close", ResponseType.CLOSE);
+                abort_button.set_sensitive(false);
+
+                response.connect(on_response);
+                destroy.connect(() => {
+                        if (engine != null && engine.is_running())
+                                engine.abort();
+                });
+
+                content.show_all();
+        }
+
+        private void on_response(int id) {
+                if (id == 1) {
+                        start_button.set_sensitive(false);
+                        abort_button.set_sensitive(true);
+                        concurrency_spin.set_sensitive(false);
+                        timeout_spin.set_sensitive(false);
+                        failures_spin.set_sensitive(false);
+
+                        engine = new RollingRestart(bus, manager, paths,
+                                                    concurrency_spin.get_value_as_int(),
+                                                    (uint) timeout_spin.get_value_as_int(),
+                                                    failures_spin.get_value_as_int());
+                        engine.unit_changed.connect(on_unit_changed);
+                        engine.finished.connect(on_finished);
+                        engine.start();
+                } else if (id == 2) {
+                        if (engine != null)
+                                engine.abort();
+                } else
+                        destroy();
+        }
+
+        private static unowned string result_text(RestartResult r) {
+                switch (r) {
+                case RestartResult.RESTARTING:
+                        return "restarting";
+                case RestartResult.HEALTHY:
+                        return "running";
+                case RestartResult.TIMED_OUT:
+                        return "timed out";
+                case RestartResult.FAILED:
+                        return "failed";
+                case RestartResult.SKIPPED:
+                        return "skipped";
+                default:
+                        return "pending";
+                }
+        }
+
+        private void on_unit_changed(int index) {
+                TreeIter iter;
+
+                if (unit_store.iter_nth_child(out iter, null, index))
+                        unit_store.set(iter, 1, result_text(engine.results[index]));
+
+                progress_bar.set_fraction((double) engine.get_done() / paths.length);
+                progress_bar.set_text("%d of %d".printf(engine.get_done(), paths.length));
+                summary_label.set_text("%d running, %d timed out, %d failed".printf(
+                                               engine.healthy, engine.timed_out, engine.failed));
+        }
+
+        private void on_finished() {
+                abort_button.set_sensitive(false);
+
+                if (engine.aborted)
+                        summary_label.set_text("Aborted: %d running, %d timed out, %d failed".printf(
+                                                       engine.healthy, engine.timed_out, engine.failed));
+        }
+}
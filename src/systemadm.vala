@@ -37,6 +37,38 @@ public void new_column(TreeView view, int column_id, string title) {
         view.insert_column(col, -1);
 }
 
+/* Columns that hold a state code, the text is only looked up when the
+ * cell is drawn */
+public void new_state_column(TreeView view, int column_id, string title, StateTable states, string prefix = "") {
+        TreeViewColumn col = new TreeViewColumn();
+        CellRendererText renderer = new CellRendererText();
+
+        col.set_title(title);
+        col.pack_start(renderer, true);
+        col.set_cell_data_func(renderer, (c, cell, model, iter) => {
+                int code;
+                model.get(iter, column_id, out code);
+                ((CellRendererText) cell).text = code != 0 ? prefix + states.get_name(code) : "";
+        });
+        col.set_sort_column_id(column_id);
+        view.insert_column(col, -1);
+}
+
+public void new_prefixed_column(TreeView view, int column_id, string title, string prefix) {
+        TreeViewColumn col = new TreeViewColumn();
+        CellRendererText renderer = new CellRendererText();
+
+        col.set_title(title);
+        col.pack_start(renderer, true);
+        col.set_cell_data_func(renderer, (c, cell, model, iter) => {
+                string? text;
+                model.get(iter, column_id, out text);
+                ((CellRendererText) cell).text = text != null ? prefix + text : "";
+        });
+        col.set_sort_column_id(column_id);
+        view.insert_column(col, -1);
+}
+
 public class LeftLabel : Label {
         public LeftLabel(string? text = null) {
                 if (text != null)
@@ -73,6 +105,122 @@ public class RightLabel : Label {
         }
 }
 
+/* A menu button with a check box per choice, any number of which can be
+ * active. Choice n is bit n + 1 of the mask. Bit 0 and the bits above the
+ * choices stand for values we do not know about, the check boxes never
+ * clear them. */
+public class FilterButton : MenuButton {
+
+        public uint mask { get; private set; }
+
+        private string all_label;
+        private string noun;
+        private string[] labels;
+        private CheckButton[] checks = {};
+        private Label label;
+
+        public signal void changed();
+
+        public FilterButton(string all_label, string noun, string[] labels, uint mask) {
+                this.all_label = all_label;
+                this.noun = noun;
+                this.labels = labels;
+                this.mask = mask | 1;
+
+                Box button_box = new Box(Orientation.HORIZONTAL, 6);
+                label = new Label(null);
+                button_box.pack_start(label, false, false, 0);
+                button_box.pack_start(new Image.from_icon_name("pan-down-symbolic", IconSize.BUTTON), false, false, 0);
+                remove(get_child());
+                add(button_box);
+                button_box.show_all();
+
+                Box box = new Box(Orientation.VERTICAL, 0);
+                box.set_border_width(6);
+
+                for (int i = 0; i < labels.length; i++) {
+                        CheckButton c = new CheckButton.with_label(labels[i]);
+                        c.set_active((this.mask & (1 << (i + 1))) != 0);
+                        c.toggled.connect(on_toggled);
+                        box.pack_start(c, false, false, 0);
+                        checks += c;
+                }
+
+                box.show_all();
+
+                Popover popover = new Popover(this);
+                popover.add(box);
+                set_popover(popover);
+
+                update_label();
+        }
+
+        /* Turns one choice on, no-op if it already is */
+        public void set_choice(int n) {
+                checks[n - 1].set_active(true);
+        }
+
+        public bool is_all() {
+                foreach (CheckButton c in checks)
+                        if (!c.get_active())
+                                return false;
+
+                return true;
+        }
+
+        /* Only the bits of the choices change, the others stay as
+         * they were, so values beyond the choices keep passing */
+        private void on_toggled() {
+                uint m = mask;
+
+                for (int i = 0; i < checks.length; i++) {
+                        if (checks[i].get_active())
+                                m |= 1 << (i + 1);
+                        else
+                                m &= ~(1 << (i + 1));
+                }
+
+                mask = m;
+                update_label();
+                changed();
+        }
+
+        private void update_label() {
+                string[] active = {};
+
+                for (int i = 0; i < checks.length; i++)
+                        if (checks[i].get_active())
+                                active += labels[i];
+
+                if (active.length == checks.length)
+                        label.set_text(all_label);
+                else if (active.length == 0)
+                        label.set_text("No %s".printf(noun));
+                else if (active.length <= 2)
+                        label.set_text(string.joinv(", ", active));
+                else
+                        label.set_text("%d %s".printf(active.length, noun));
+        }
+}
+
+/* The units of one dependency relation of the shown unit, sorted. The
+ * rows for them are only created when the relation is expanded. */
+public class DependencyRelation {
+        public string word;
+        public string[] units = {};
+
+        public DependencyRelation(string word, string[] dependencies) {
+                this.word = word;
+
+                Gee.TreeSet<unowned string> sorted = new Gee.TreeSet<unowned string>();
+                foreach (unowned string i in dependencies)
+                        sorted.add(i);
+
+                foreach (unowned string i in sorted)
+                        units += i;
+        }
+}
+
 public ScrolledWindow new_scrolled_window(Widget widget) {
        ScrolledWindow scroll = new ScrolledWindow(null, null);
        scroll.set_policy(PolicyType.AUTOMATIC, PolicyType.AUTOMATIC);
@@ -81,24 +229,189 @@ public ScrolledWindow new_scrolled_window(Widget widget) {
        return scroll;
 }
 
+public enum UpdateOperation {
+        CHANGE,
+        NEW,
+        REMOVE
+}
+
+/* Changes to a unit or job that have not been applied to the model yet.
+ * Properties that were invalidated without a value are stored as null. */
+public class PendingUpdate {
+        public string path;
+        public bool job;
+        public UpdateOperation operation;
+        public string? id;
+        public uint32 job_id;
+        public HashTable<string, Variant?> properties;
+
+        public PendingUpdate(string path, bool job) {
+                this.path = path;
+                this.job = job;
+                operation = UpdateOperation.CHANGE;
+                properties = new HashTable<string, Variant?>(str_hash, str_equal);
+        }
+}
+
+public enum UnitAction {
+        START,
+        STOP,
+        RELOAD,
+        RESTART,
+        RESET_FAILED;
+
+        /* Also the type of the job the action queues */
+        public unowned string get_verb() {
+                switch (this) {
+                case START:
+                        return "start";
+                case STOP:
+                        return "stop";
+                case RELOAD:
+                        return "reload";
+                case RESTART:
+                        return "restart";
+                default:
+                        return "reset";
+                }
+        }
+
+        public unowned string get_method() {
+                switch (this) {
+                case START:
+                        return "Start";
+                case STOP:
+                        return "Stop";
+                case RELOAD:
+                        return "Reload";
+                case RESTART:
+                        return "Restart";
+                default:
+                        return "ResetFailed";
+                }
+        }
+
+        public bool queues_job() {
+                return this != RESET_FAILED;
+        }
+}
+
+/* One action on a set of units. All method calls are sent at once, the
+ * replies and the results of the queued jobs are counted here. */
+public class BatchAction {
+        public UnitAction action;
+        public int units;
+        public int replies = 0;
+        public int jobs = 0;
+        public int jobs_finished = 0;
+        public int jobs_failed = 0;
+        public string[] errors = {};
+
+        /* Only for batches of one, to name the unit in messages */
+        public string? unit_id = null;
+
+        public BatchAction(UnitAction action, int units) {
+                this.action = action;
+                this.units = units;
+        }
+}
+
+/* A job queued from this window, reported in the status bar when
+ * JobRemoved comes in */
+public class TrackedJob {
+        public string unit_id;
+        public BatchAction batch;
+
+        public TrackedJob(string unit_id, BatchAction batch) {
+                this.unit_id = unit_id;
+                this.batch = batch;
+        }
+}
+
 public class MainWindow : Window {
 
+        /* Flushes touching more objects than this detach the unit view */
+        private const uint BULK_UPDATE_THRESHOLD = 256;
+
         private string? current_unit_id;
         private uint32 current_job_id;
 
         private TreeView unit_view;
         private TreeView job_view;
 
-        private Gtk.ListStore unit_model;
+        private UnitModel unit_model;
         private Gtk.ListStore job_model;
 
-        private Gee.HashMap<string, Unit> unit_map;
+        private TreeModelFilter? unit_model_filter;
+        private TreeModelSort? unit_model_sort;
+
+        /* Sort order, cursor, selection and the unit at the top of the
+         * view saved across a bulk update. While the view is detached
+         * its cursor and selection signals are ignored. */
+        private bool unit_sorted;
+        private int unit_sort_column;
+        private SortType unit_sort_order;
+        private string? unit_bulk_cursor;
+        private string[] unit_bulk_selection = {};
+        private string? unit_bulk_top;
+        private bool unit_view_detached = false;
+
+        /* Only the unit shown in the detail pane has a proxy of its own */
+        private Unit? current_unit;
+        private bool current_can_start = false;
+        private bool current_can_reload = false;
+
+        /* Job rows by object path. The iterators of a Gtk.ListStore stay
+         * valid until the row is removed. Units are indexed by the unit
+         * model itself. */
+        private HashTable<string, TreeIter?> job_rows;
+
+        /* Signals are merged per object here and applied to the models
+         * once per frame */
+        private HashTable<string, PendingUpdate> pending_updates;
+        private Queue<PendingUpdate> pending_queue;
+        private uint flush_tick;
+
+        private DBusConnection bus;
+        private uint properties_changed_subscription;
 
         private Button start_button;
         private Button stop_button;
         private Button restart_button;
         private Button reload_button;
+        private Button reset_failed_button;
+        private Button rolling_restart_button;
         private Button cancel_button;
+        private Button stop_waiting_button;
+
+        private Statusbar statusbar;
+        private uint statusbar_context;
+
+        /* Method calls still waiting for a reply, all of them share one
+         * cancellable that is replaced once it is used */
+        private Cancellable call_cancellable;
+        private int pending_calls = 0;
+
+        private HashTable<string, TrackedJob> tracked_jobs;
+
+        /* Set between Reloading(true) and Reloading(false), the per
+         * object signals are ignored then and one resync follows */
+        private bool reloading = false;
+
+        /* A unit the filters left out changed state, it may have to be
+         * shown now. Coalesces bursts into one refetch. */
+        private uint unit_resync_timeout = 0;
+
+        /* Bumped for every unit list fetch, replies to older ones are
+         * dropped */
+        private uint unit_fetch_serial = 0;
+
+        /* Sub-states of the units linked from the detail pane that the
+         * filters keep out of the unit model, by id, and their ids by
+         * object path so that PropertiesChanged can update them */
+        private HashTable<string, int> link_sub_states;
+        private HashTable<string, string> link_ids;
+        private uint link_fetch_serial = 0;
 
         private Entry unit_load_entry;
         private Button unit_load_button;
@@ -109,7 +422,9 @@ public class MainWindow : Window {
         private Manager manager;
 
         private RightLabel unit_id_label;
-        private RightLabel unit_dependency_label;
+        private TreeView unit_dependency_view;
+        private TreeStore dependency_store;
+        private DependencyRelation[] dependency_relations = {};
         private RightLabel unit_description_label;
         private RightLabel unit_load_state_label;
         private RightLabel unit_active_state_label;
@@ -125,8 +440,37 @@ public class MainWindow : Window {
         private RightLabel job_state_label;
         private RightLabel job_type_label;
 
-        private ComboBoxText unit_type_combo_box;
-        private CheckButton inactive_checkbox;
+        private FilterButton unit_type_button;
+        private FilterButton active_state_button;
+        private SearchEntry unit_search_entry;
+
+        /* Requests in flight while the dependency graph is loaded */
+        private const int DEPENDENCY_FETCH_WINDOW = 32;
+
+        private DependencyGraph dependency_graph;
+        private bool dependency_graph_loaded = false;
+        private Queue<string> dependency_fetch_queue;
+        private int dependency_fetches = 0;
+        private bool dependency_graph_stale = false;
+
+        private DependencyGraphView dependency_graph_view;
+        private Entry graph_unit_entry;
+        private ComboBoxText graph_mode_combo_box;
+        private CheckButton[] graph_type_checks = {};
+        private Label graph_status_label;
+        private RightLabel graph_why_label;
+
+        /* Loaded when the tab is first shown. The states are also
+         * joined into the unit list by id. */
+        private Gtk.ListStore unit_file_model;
+        private TreeModelFilter unit_file_filter;
+        private PatternSpec? unit_file_pattern = null;
+        private HashTable<string, string> unit_file_states;
+        private bool unit_files_loaded = false;
+        private uint unit_file_fetch_serial = 0;
+        private TreeView unit_file_view;
+        private Entry unit_file_pattern_entry;
+        private Label unit_file_status_label;
 
         public MainWindow() throws DBusError, IOError {
                 title = user ? "systemd User Service Manager" : "systemd System Manager";
@@ -135,8 +479,28 @@ public class MainWindow : Window {
                 set_border_width(12);
                 destroy.connect(Gtk.main_quit);
 
+                Box main_vbox = new Box(Orientation.VERTICAL, 6);
+                add(main_vbox);
+
                 Notebook notebook = new Notebook();
-                add(notebook);
+                main_vbox.pack_start(notebook, true, true, 0);
+
+                statusbar = new Statusbar();
+                statusbar_context = statusbar.get_context_id("jobs");
+
+                stop_waiting_button = new Button.with_mnemonic("Stop _Waiting");
+                stop_waiting_button.set_sensitive(false);
+                stop_waiting_button.clicked.connect(on_stop_waiting);
+
+                Box status_hbox = new Box(Orientation.HORIZONTAL, 6);
+                status_hbox.pack_start(statusbar, true, true, 0);
+                status_hbox.pack_end(stop_waiting_button, false, false, 0);
+                main_vbox.pack_end(status_hbox, false, false, 0);
+
+                call_cancellable = new Cancellable();
+                tracked_jobs = new HashTable<string, TrackedJob>(str_hash, str_equal);
+                link_sub_states = new HashTable<string, int>(str_hash, str_equal);
+                link_ids = new HashTable<string, string>(str_hash, str_equal);
 
                 Box unit_vbox = new Box(Orientation.VERTICAL, 12);
                 notebook.append_page(unit_vbox, new Label("Units"));
@@ -146,30 +510,115 @@ public class MainWindow : Window {
                 notebook.append_page(job_vbox, new Label("Jobs"));
                 job_vbox.set_border_width(12);
 
-                unit_type_combo_box = new ComboBoxText();
+                Box graph_vbox = new Box(Orientation.VERTICAL, 12);
+                notebook.append_page(graph_vbox, new Label("Graph"));
+                graph_vbox.set_border_width(12);
+
+                Box unit_file_vbox = new Box(Orientation.VERTICAL, 12);
+                notebook.append_page(unit_file_vbox, new Label("Unit Files"));
+                unit_file_vbox.set_border_width(12);
+
+                /* The graph and the unit files are only loaded when their
+                 * tab is first shown */
+                notebook.switch_page.connect((page, n) => {
+                        if (page == graph_vbox)
+                                on_graph_page_shown();
+                        else if (page == unit_file_vbox && !unit_files_loaded)
+                                populate_unit_file_model();
+                });
+
+                unit_file_model = new Gtk.ListStore(3, typeof(string), typeof(string), typeof(string));
+                unit_file_states = new HashTable<string, string>(str_hash, str_equal);
+
+                unit_file_filter = new TreeModelFilter(unit_file_model, null);
+                unit_file_filter.set_visible_func(unit_file_filter_func);
+
+                unit_file_view = new TreeView.with_model(unit_file_filter);
+                new_column(unit_file_view, 0, "Unit File");
+                new_column(unit_file_view, 1, "State");
+                new_column(unit_file_view, 2, "Path");
+
+                unit_file_pattern_entry = new Entry();
+                unit_file_pattern_entry.set_placeholder_text("Pattern, e.g. *.service");
+                unit_file_pattern_entry.activate.connect(unit_file_pattern_changed);
+
+                Button unit_file_refresh_button = new Button.with_mnemonic("_Refresh");
+                unit_file_refresh_button.clicked.connect(populate_unit_file_model);
+
+                unit_file_status_label = new Label(null);
+
+                Box unit_file_hbox = new Box(Orientation.HORIZONTAL, 6);
+                unit_file_hbox.pack_start(unit_file_pattern_entry, false, true, 0);
+                unit_file_hbox.pack_start(unit_file_refresh_button, false, false, 0);
+                unit_file_hbox.pack_end(unit_file_status_label, false, false, 0);
+                unit_file_vbox.pack_start(unit_file_hbox, false, false, 0);
+                unit_file_vbox.pack_start(new_scrolled_window(unit_file_view), true, true, 0);
+
+                dependency_graph = new DependencyGraph();
+                dependency_fetch_queue = new Queue<string>();
+
+                graph_unit_entry = new Entry();
+                graph_unit_entry.set_placeholder_text("Unit");
+                graph_unit_entry.activate.connect(update_graph_view);
+
+                graph_mode_combo_box = new ComboBoxText();
+                graph_mode_combo_box.append_text("Dependencies");
+                graph_mode_combo_box.append_text("Why pulled in");
+                graph_mode_combo_box.set_active(0);
+                graph_mode_combo_box.changed.connect(update_graph_view);
+
+                Box graph_hbox = new Box(Orientation.HORIZONTAL, 6);
+                graph_hbox.pack_start(graph_unit_entry, false, true, 0);
+                graph_hbox.pack_start(graph_mode_combo_box, false, false, 0);
+
+                /* In DependencyType order */
+                foreach (string t in new string[] { "requires", "wants", "after", "before", "conflicts" }) {
+                        CheckButton c = new CheckButton.with_label(t);
+                        c.set_active(t == "requires" || t == "wants");
+                        c.toggled.connect(update_graph_view);
+                        graph_hbox.pack_start(c, false, false, 0);
+                        graph_type_checks += c;
+                }
+
+                graph_status_label = new Label(null);
+                graph_hbox.pack_end(graph_status_label, false, false, 0);
+                graph_vbox.pack_start(graph_hbox, false, false, 0);
+
+                dependency_graph_view = new DependencyGraphView(dependency_graph);
+                dependency_graph_view.unit_activated.connect(on_graph_unit_activated);
+
+                graph_why_label = new RightLabel();
+
+                Paned graph_paned = new Paned(Orientation.VERTICAL);
+                graph_paned.pack1(dependency_graph_view, true, true);
+                graph_paned.pack2(new_scrolled_window(graph_why_label), false, true);
+                graph_vbox.pack_start(graph_paned, true, true, 0);
+
+                /* Labels are in UnitType and ActiveState order */
+                unit_type_button = new FilterButton(
+                                "All unit types", "unit types",
+                                { "Targets", "Slices", "Scopes", "Services", "Devices", "Mounts",
+                                  "Automounts", "Swaps", "Sockets", "Paths", "Timers", "Snapshots" },
+                                ~0U);
+                unit_type_button.changed.connect(unit_type_changed);
+
+                /* Inactive units are hidden by default, unless they have
+                 * a job queued */
+                active_state_button = new FilterButton(
+                                "All states", "states",
+                                { "Active", "Reloading", "Inactive", "Failed", "Activating", "Deactivating" },
+                                ~(1U << ActiveState.INACTIVE));
+                active_state_button.changed.connect(unit_type_changed);
+
                 Box type_hbox = new Box(Orientation.HORIZONTAL, 6);
-                type_hbox.pack_start(unit_type_combo_box, false, false, 0);
+                type_hbox.pack_start(unit_type_button, false, false, 0);
+                type_hbox.pack_start(active_state_button, false, false, 0);
                 unit_vbox.pack_start(type_hbox, false, false, 0);
 
-                unit_type_combo_box.append_text("All unit types");
-                unit_type_combo_box.append_text("Targets");
-                unit_type_combo_box.append_text("Slices");
-                unit_type_combo_box.append_text("Scopes");
-                unit_type_combo_box.append_text("Services");
-                unit_type_combo_box.append_text("Devices");
-                unit_type_combo_box.append_text("Mounts");
-                unit_type_combo_box.append_text("Automounts");
-                unit_type_combo_box.append_text("Swaps");
-                unit_type_combo_box.append_text("Sockets");
-                unit_type_combo_box.append_text("Paths");
-                unit_type_combo_box.append_text("Timers");
-                unit_type_combo_box.append_text("Snapshots"); // adjust index in server_on_snapshot
-                unit_type_combo_box.set_active(0); // Show All
-                unit_type_combo_box.changed.connect(unit_type_changed);
-
-                inactive_checkbox = new CheckButton.with_label("inactive too");
-                inactive_checkbox.toggled.connect(unit_type_changed);
-                type_hbox.pack_start(inactive_checkbox, false, false, 0);
+                unit_search_entry = new SearchEntry();
+                unit_search_entry.set_placeholder_text("Search units");
+                unit_search_entry.search_changed.connect(on_unit_search_changed);
+                type_hbox.pack_start(unit_search_entry, false, true, 0);
 
                 unit_load_entry = new Entry();
                 unit_load_button = new Button.with_mnemonic("_Load");
@@ -193,32 +642,34 @@ public class MainWindow : Window {
                 type_hbox.pack_end(server_reload_button, false, true, 0);
                 type_hbox.pack_end(unit_load_hbox, false, true, 24);
 
-                unit_model = new Gtk.ListStore(7, typeof(string), typeof(string), typeof(string), typeof(string), typeof(string), typeof(string), typeof(Unit));
-                job_model = new Gtk.ListStore(6, typeof(string), typeof(string), typeof(string), typeof(string), typeof(Job), typeof(uint32));
+                unit_model = new UnitModel();
+                job_model = new Gtk.ListStore(6, typeof(string), typeof(string), typeof(string), typeof(string), typeof(string), typeof(uint32));
 
-                unit_map = new Gee.HashMap<string, Unit>();
-
-                TreeModelFilter unit_model_filter;
-                unit_model_filter = new TreeModelFilter(unit_model, null);
-                unit_model_filter.set_visible_func(unit_filter);
+                job_rows = new HashTable<string, TreeIter?>(str_hash, str_equal);
 
-                TreeModelSort unit_model_sort = new TreeModelSort.with_model(unit_model_filter);
+                pending_updates = new HashTable<string, PendingUpdate>(str_hash, str_equal);
+                pending_queue = new Queue<PendingUpdate>();
 
-                unit_view = new TreeView.with_model(unit_model_sort);
+                /* The filter and sort models are attached by
+                 * end_unit_bulk_update() */
+                unit_view = new TreeView();
                 job_view = new TreeView.with_model(job_model);
 
                 unit_view.cursor_changed.connect(unit_changed);
+                unit_view.get_selection().set_mode(SelectionMode.MULTIPLE);
+                unit_view.get_selection().changed.connect(unit_selection_changed);
                 job_view.cursor_changed.connect(job_changed);
 
-                new_column(unit_view, 2, "Load State");
-                new_column(unit_view, 3, "Active State");
-                new_column(unit_view, 4, "Unit State");
+                new_state_column(unit_view, 2, "Load State", unit_model.load_states);
+                new_state_column(unit_view, 3, "Active State", unit_model.active_states);
+                new_state_column(unit_view, 4, "Unit State", unit_model.sub_states);
                 new_column(unit_view, 0, "Unit");
-                new_column(unit_view, 5, "Job");
+                new_state_column(unit_view, 5, "Job", unit_model.job_types, "→ ");
+                new_unit_file_state_column();
 
                 new_column(job_view, 0, "Job");
                 new_column(job_view, 1, "Unit");
-                new_column(job_view, 2, "Type");
+                new_prefixed_column(job_view, 2, "Type", "→ ");
                 new_column(job_view, 3, "State");
 
                 Paned paned = new Paned(Orientation.VERTICAL);
@@ -238,7 +689,6 @@ public class MainWindow : Window {
                 paned.pack2(new_scrolled_window(job_vbox2), false, true);
 
                 unit_id_label = new RightLabel();
-                unit_dependency_label = new RightLabel();
                 unit_description_label = new RightLabel();
                 unit_load_state_label = new RightLabel();
                 unit_active_state_label = new RightLabel();
@@ -254,9 +704,28 @@ public class MainWindow : Window {
                 job_state_label = new RightLabel();
                 job_type_label = new RightLabel();
 
-                unit_dependency_label.set_track_visited_links(false);
-                unit_dependency_label.set_selectable(true);
-                unit_dependency_label.activate_link.connect(on_activate_link);
+                /* One collapsed row per relation, markup and unit id for
+                 * the units, the relation index for the relation rows */
+                dependency_store = new TreeStore(3, typeof(string), typeof(string), typeof(int));
+                unit_dependency_view = new TreeView.with_model(dependency_store);
+                unit_dependency_view.set_headers_visible(false);
+                unit_dependency_view.set_activate_on_single_click(true);
+
+                TreeViewColumn dependency_column = new TreeViewColumn.with_attributes(
+                                null, new CellRendererText(), "markup", 0);
+                dependency_column.set_sizing(TreeViewColumnSizing.FIXED);
+                unit_dependency_view.insert_column(dependency_column, -1);
+
+                /* Only the visible rows are measured and drawn */
+                unit_dependency_view.set_fixed_height_mode(true);
+
+                unit_dependency_view.test_expand_row.connect(on_dependency_expand);
+                unit_dependency_view.row_activated.connect(on_dependency_activated);
+
+                ScrolledWindow dependency_scroll = new_scrolled_window(unit_dependency_view);
+                dependency_scroll.set_min_content_height(160);
+                dependency_scroll.set_shadow_type(ShadowType.IN);
+                dependency_scroll.hexpand = true;
 
                 unit_fragment_path_label.set_track_visited_links(false);
 
@@ -275,7 +744,7 @@ public class MainWindow : Window {
                 unit_grid.attach(new LeftLabel("Description:"),            0, 1, 1, 1);
                 unit_grid.attach(unit_description_label,                   1, 1, 5, 1);
                 unit_grid.attach(new LeftLabel("Dependencies:"),           0, 2, 1, 1);
-                unit_grid.attach(unit_dependency_label,                    1, 2, 5, 1);
+                unit_grid.attach(dependency_scroll,                        1, 2, 5, 1);
                 unit_grid.attach(new LeftLabel("Fragment Path:"),          0, 3, 1, 1);
                 unit_grid.attach(unit_fragment_path_label,                 1, 3, 5, 1);
                 unit_grid.attach(new LeftLabel("Control Group:"),          0, 4, 1, 1);
@@ -314,16 +783,23 @@ public class MainWindow : Window {
                 stop_button = new Button.with_mnemonic("Sto_p");
                 reload_button = new Button.with_mnemonic("_Reload");
                 restart_button = new Button.with_mnemonic("Res_tart");
+                reset_failed_button = new Button.with_mnemonic("Reset _Failed");
+                rolling_restart_button = new Button.with_mnemonic("Rolling Restart…");
 
                 start_button.clicked.connect(on_start);
                 stop_button.clicked.connect(on_stop);
                 reload_button.clicked.connect(on_reload);
                 restart_button.clicked.connect(on_restart);
+                reset_failed_button.clicked.connect(on_reset_failed);
+                reset_failed_button.set_sensitive(false);
+                rolling_restart_button.clicked.connect(on_rolling_restart);
 
                 bbox.pack_start(start_button, false, true, 0);
                 bbox.pack_start(stop_button, false, true, 0);
                 bbox.pack_start(restart_button, false, true, 0);
                 bbox.pack_start(reload_button, false, true, 0);
+                bbox.pack_start(reset_failed_button, false, true, 0);
+                bbox.pack_start(rolling_restart_button, false, true, 0);
 
                 bbox = new ButtonBox(Orientation.HORIZONTAL);
                 bbox.set_layout(ButtonBoxStyle.START);
@@ -345,309 +821,950 @@ public class MainWindow : Window {
                 manager.job_new.connect(on_job_new);
                 manager.unit_removed.connect(on_unit_removed);
                 manager.job_removed.connect(on_job_removed);
+                manager.reloading.connect(on_reloading);
+                manager.unit_files_changed.connect(on_unit_files_changed);
+
+                /* A single match rule covers the property changes of all
+                 * units and jobs, instead of one per object */
+                bus = manager.get_connection();
+                properties_changed_subscription = bus.signal_subscribe(
+                                "org.freedesktop.systemd1",
+                                "org.freedesktop.DBus.Properties",
+                                "PropertiesChanged",
+                                null,
+                                null,
+                                DBusSignalFlags.NONE,
+                                on_properties_changed);
 
                 manager.subscribe();
+                manager.notify["g-name-owner"].connect(on_manager_owner_changed);
 
                 clear_unit();
                 clear_job();
-                populate_unit_model();
+                end_unit_bulk_update();
+                populate_unit_model.begin();
                 populate_job_model();
         }
 
-        public void populate_unit_model() throws DBusError, IOError {
-                unit_model.clear();
+        /* Takes the filter and sort models off the unit list, so that bulk
+         * changes do not go through them row by row */
+        public void begin_unit_bulk_update() {
+                unit_view_detached = true;
+                unit_bulk_cursor = current_unit_id;
+                unit_bulk_selection = {};
+                unit_bulk_top = null;
 
-                var list = manager.list_units();
+                if (unit_model_sort != null) {
+                        unit_sorted = unit_model_sort.get_sort_column_id(out unit_sort_column, out unit_sort_order);
 
-                foreach (var i in list) {
-                        TreeIter iter;
+                        TreeModel model;
+                        foreach (unowned TreePath p in unit_view.get_selection().get_selected_rows(out model))
+                                unit_bulk_selection += get_unit_view_id(p);
 
-                        Properties p = Bus.get_proxy_sync(
-                                        user ? BusType.SESSION : BusType.SYSTEM,
-                                        "org.freedesktop.systemd1",
-                                        i.unit_path);
+                        TreePath top;
+                        if (unit_view.get_visible_range(out top, null))
+                                unit_bulk_top = get_unit_view_id(top);
+                }
 
-                        p.properties_changed.connect(on_unit_changed);
+                unit_view.set_model(null);
+                unit_model_sort = null;
+                unit_model_filter = null;
+        }
 
-                        Unit u = Bus.get_proxy_sync(
-                                        user ? BusType.SESSION : BusType.SYSTEM,
-                                        "org.freedesktop.systemd1",
-                                        i.unit_path);
+        /* Builds the filter and sort models again, which filters and
+         * sorts everything in one go */
+        public void end_unit_bulk_update() {
+                /* Nothing is attached, the removed rows can go */
+                unit_model.compact();
 
-                        unit_map[i.id] = u;
+                unit_model_filter = new TreeModelFilter(unit_model, null);
+                unit_model_filter.set_visible_func(unit_filter);
 
-                        unit_model.append(out iter);
-                        unit_model.set(iter,
-                                       0, i.id,
-                                       1, i.description,
-                                       2, i.load_state,
-                                       3, i.active_state,
-                                       4, i.sub_state,
-                                       5, i.job_type != "" ? "→ %s".printf(i.job_type) : "",
-                                       6, u);
-                }
-        }
+                unit_model_sort = new TreeModelSort.with_model(unit_model_filter);
+                if (unit_sorted)
+                        unit_model_sort.set_sort_column_id(unit_sort_column, unit_sort_order);
 
-        public void populate_job_model() throws DBusError, IOError {
-                job_model.clear();
+                unit_view.set_model(unit_model_sort);
 
-                var list = manager.list_jobs();
+                TreePath? p;
 
-                foreach (var i in list) {
-                        TreeIter iter;
+                if (unit_bulk_cursor != null && (p = get_unit_view_path(unit_bulk_cursor)) != null)
+                        unit_view.set_cursor(p, null, false);
 
-                        Properties p = Bus.get_proxy_sync(
-                                        user ? BusType.SESSION : BusType.SYSTEM,
-                                        "org.freedesktop.systemd1",
-                                        i.job_path);
+                TreeSelection selection = unit_view.get_selection();
+                foreach (unowned string id in unit_bulk_selection)
+                        if ((p = get_unit_view_path(id)) != null)
+                                selection.select_path(p);
 
-                        p.properties_changed.connect(on_job_changed);
+                if (unit_bulk_top != null && (p = get_unit_view_path(unit_bulk_top)) != null)
+                        unit_view.scroll_to_cell(p, null, true, 0, 0);
 
-                        Job j = Bus.get_proxy_sync(
-                                        user ? BusType.SESSION : BusType.SYSTEM,
-                                        "org.freedesktop.systemd1",
-                                        i.job_path);
+                unit_bulk_cursor = null;
+                unit_bulk_selection = {};
+                unit_bulk_top = null;
+                unit_view_detached = false;
 
-                        job_model.append(out iter);
-                        job_model.set(iter,
-                                      0, "%u".printf(i.id),
-                                      1, i.name,
-                                      2, "→ %s".printf(i.type),
-                                      3, i.state,
-                                      4, j,
-                                      5, i.id);
-                }
+                /* The cursor unit may have been filtered out */
+                unit_changed();
+                unit_selection_changed();
         }
 
-        public Unit? get_current_unit() {
-                TreePath p;
-                unit_view.get_cursor(out p, null);
+        private string get_unit_view_id(TreePath p) {
+                TreeIter iter;
+                string id;
 
-                if (p == null)
-                        return null;
+                unit_model_sort.get_iter(out iter, p);
+                unit_model_sort.get(iter, 0, out id);
 
-                TreeModel model = unit_view.get_model();
-                TreeIter iter;
-                Unit u;
+                return id;
+        }
 
-                model.get_iter(out iter, p);
-                model.get(iter, 6, out u);
+        /* Where a unit is in the view, null if it is filtered out */
+        private TreePath? get_unit_view_path(string id) {
+                TreeIter iter, filter_iter, sort_iter;
 
-                return u;
+                if (!unit_model.lookup_id(id, out iter))
+                        return null;
+
+                if (!unit_model_filter.convert_child_iter_to_iter(out filter_iter, iter))
+                        return null;
+
+                unit_model_sort.convert_child_iter_to_iter(out sort_iter, filter_iter);
+                return unit_model_sort.get_path(sort_iter);
         }
 
-        public Unit? get_unit(string id) {
-                return this.unit_map[id];
+        public void select_unit(string id) {
+                TreePath? p = get_unit_view_path(id);
+
+                if (p != null)
+                        unit_view.set_cursor(p, null, false);
         }
 
-        public void unit_changed() {
-                Unit u = get_current_unit();
+        /* The active states picked in the filter button, none if all of
+         * them are. Values we do not know about cannot be asked for and
+         * are left out. */
+        private string[] get_filter_states() {
+                string[] states = {};
 
-                if (u == null)
-                        clear_unit();
-                else
-                        show_unit(u);
+                if (!active_state_button.is_all())
+                        for (int n = ActiveState.ACTIVE; n <= ActiveState.DEACTIVATING; n++)
+                                if ((active_state_button.mask & (1 << n)) != 0)
+                                        states += unit_model.active_states.get_name(n);
+
+                return states;
         }
 
-        public void clear_unit() {
-                current_unit_id = null;
+        private string[] get_filter_patterns() {
+                string[] patterns = {};
 
-                start_button.set_sensitive(false);
-                stop_button.set_sensitive(false);
-                reload_button.set_sensitive(false);
-                restart_button.set_sensitive(false);
+                if (!unit_type_button.is_all())
+                        for (int n = UnitType.TARGET; n <= UnitType.SNAPSHOT; n++)
+                                if ((unit_type_button.mask & (1 << n)) != 0)
+                                        patterns += "*." + UNIT_TYPES[n - 1];
 
-                unit_id_label.set_text_or_na();
-                unit_description_label.set_text_or_na();
-                unit_description_label.set_text_or_na();
-                unit_load_state_label.set_text_or_na();
-                unit_active_state_label.set_text_or_na();
-                unit_sub_state_label.set_text_or_na();
-                unit_fragment_path_label.set_text_or_na();
-                unit_active_enter_timestamp_label.set_text_or_na();
-                unit_active_exit_timestamp_label.set_text_or_na();
-                unit_can_reload_label.set_text_or_na();
-                unit_can_start_label.set_text_or_na();
-                unit_cgroup_label.set_text_or_na();
+                return patterns;
         }
 
-        public string format_unit_link(string i, bool link) {
-                Unit? u = get_unit(i);
-                if(u == null)
-                        return "<span color='grey'>" + i + "</span";
-
-                string color;
-                switch (u.sub_state) {
-                case "active": color = "blue"; break;
-                case "dead": color = "black"; break;
-                case "running": color = "green"; break;
-                case "plugged": color = "light blue"; break;
-                case "mounted": color = "light green"; break;
-                case "exited": color = "brown"; break;
-                case "failed": color = "red"; break;
-                default: color = "black"; break;
+        /* Lets PID 1 do the filtering, with ListUnitsByPatterns */
+        private async Manager.UnitInfo[] list_filtered_units(string[] states, string[] patterns) throws DBusError, IOError {
+                if (states.length == 0 && patterns.length == 0)
+                        return yield manager.list_units_async();
+
+                try {
+                        if (patterns.length == 0)
+                                return yield manager.list_units_filtered(states);
+
+                        return yield manager.list_units_by_patterns(states, patterns);
+                } catch (DBusError.UNKNOWN_METHOD e) {
+                        /* Older systemd, filter on our side only */
+                        return yield manager.list_units_async();
                 }
-                string span = "<span underline='none' color='" + color + "'>"
-                              + i + "(" +
-                              u.sub_state + ")" + "</span>";
-                if(link)
-                        return  " <a href='" + i + "'>" + span + "</a>";
-                else
-                        return span;
         }
 
+        /* Reconciles the unit list with what the filters let through:
+         * rows are only added, updated or removed where they differ, so
+         * the selection and the scroll position survive. Everything we
+         * need for the list comes with the reply, no proxies are
+         * involved. The calls do not block the UI; when the filters
+         * change again before the reply is in, it is dropped. */
+        public async void populate_unit_model() {
+                uint serial = ++unit_fetch_serial;
+                string[] states = get_filter_states();
+                Manager.UnitInfo[] list;
+                Manager.JobInfo[] jobs = {};
 
-        public string make_dependency_string(string? prefix, string word, string[] dependencies) {
-                Gee.Collection<unowned string> sorted = new Gee.TreeSet<unowned string>();
-                foreach (string i in dependencies)
-                        sorted.add(i);
+                try {
+                        list = yield list_filtered_units(states, get_filter_patterns());
+
+                        if (states.length > 0)
+                                jobs = yield manager.list_jobs_async();
+                } catch (Error e) {
+                        show_error(e);
+                        return;
+                }
+
+                if (serial != unit_fetch_serial || reloading)
+                        return;
 
-                bool first = true;
-                string r;
+                Gee.HashSet<string> listed = new Gee.HashSet<string>();
+                int added = 0;
 
-                if (prefix == null)
-                        r = "";
-                else
-                        r = prefix;
+                foreach (var i in list) {
+                        listed.add(i.unit_path);
+                        if (!unit_model.contains_path(i.unit_path))
+                                added++;
+                }
 
-                foreach (string i in sorted) {
-                        if (r != "")
-                                r += first ? "\n" : ",";
+                /* Units with a job are shown whatever their state. They
+                 * are added by object path below, not looked up by name:
+                 * unit names are no valid glob patterns. */
+                Gee.ArrayList<Manager.JobInfo?> job_units = new Gee.ArrayList<Manager.JobInfo?>();
 
-                        if (first) {
-                                r += "<b>" + word + ":</b>";
-                                first = false;
-                        }
+                foreach (var j in jobs) {
+                        if ((unit_type_button.mask & (1 << unit_type_from_id(j.name))) == 0 ||
+                            j.unit_path in listed)
+                                continue;
 
-                        r += format_unit_link(i, true);
+                        listed.add(j.unit_path);
+                        job_units.add(j);
                 }
 
-                return r;
-        }
+                Gee.ArrayList<string> removed_ids = new Gee.ArrayList<string>();
+                Gee.ArrayList<string> removed_paths = new Gee.ArrayList<string>();
 
-        public void show_unit(Unit unit) {
-                current_unit_id = unit.id;
+                unit_model.foreach((model, p, iter) => {
+                        unowned string? path = unit_model.get_object_path(iter);
 
-                string id_display = format_unit_link(current_unit_id, false);
-                bool has_alias = false;
-                foreach (string i in unit.names) {
-                        if (i == current_unit_id)
-                                continue;
+                        if (path != null && !(path in listed)) {
+                                removed_ids.add(unit_model.get_id(iter));
+                                removed_paths.add(path);
+                        }
 
-                        if (!has_alias) {
-                                id_display += " (aliases:";
-                                has_alias = true;
+                        return false;
+                });
+
+                /* Only a large difference, like the first population, is
+                 * worth detaching the view for */
+                bool bulk = added + removed_paths.size > BULK_UPDATE_THRESHOLD ||
+                            unit_model.needs_compaction();
+
+                if (bulk)
+                        begin_unit_bulk_update();
+
+                for (int n = 0; n < removed_paths.size; n++)
+                        remove_unit(removed_ids[n], removed_paths[n]);
+
+                foreach (var i in list) {
+                        TreeIter iter;
+
+                        if (!unit_model.lookup_path(i.unit_path, out iter)) {
+                                unit_model.append(out iter,
+                                                  i.id,
+                                                  i.unit_path,
+                                                  i.description,
+                                                  i.load_state,
+                                                  i.active_state,
+                                                  i.sub_state,
+                                                  i.job_type);
+                                continue;
                         }
 
-                        id_display += " " + i;
+                        /* Only emits row-changed for actual changes */
+                        unit_model.set_column(iter, 1, i.description);
+                        unit_model.set_column(iter, 2, i.load_state);
+                        unit_model.set_column(iter, 3, i.active_state);
+                        unit_model.set_column(iter, 4, i.sub_state);
+                        unit_model.set_column(iter, 5, i.job_type);
                 }
-                if(has_alias)
-                        id_display += ")";
 
-                unit_id_label.set_markup_or_na(id_display);
-
-                string[]
-                        requires = unit.requires,
-                        requires_overridable = unit.requires_overridable,
-                        requisite = unit.requisite,
-                        requisite_overridable = unit.requisite_overridable,
-                        wants = unit.wants,
-                        required_by = unit.required_by,
-                        required_by_overridable = unit.required_by_overridable,
-                        wanted_by = unit.wanted_by,
-                        conflicts = unit.conflicts,
-                        before = unit.before,
-                        after = unit.after;
-
-                unit_dependency_label.set_markup_or_na(
-                                make_dependency_string(
-                                make_dependency_string(
-                                make_dependency_string(
-                                make_dependency_string(
-                                make_dependency_string(
-                                make_dependency_string(
-                                make_dependency_string(
-                                make_dependency_string(
-                                make_dependency_string(
-                                make_dependency_string(
-                                make_dependency_string(null,
-                                "requires", requires),
-                                "overridable requires", requires_overridable),
-                                "requisite", requisite),
-                                "overridable requisite", requisite_overridable),
-                                "wants", wants),
-                                "conflicts", conflicts),
-                                "required by", required_by),
-                                "overridable required by", required_by_overridable),
-                                "wanted by", wanted_by),
-                                "after", after),
-                                "before", before));
+                foreach (var j in job_units)
+                        add_unit(j.name, j.unit_path);
 
-                unit_description_label.set_text_or_na(unit.description);
-                unit_load_state_label.set_text_or_na(unit.load_state);
-                unit_active_state_label.set_text_or_na(unit.active_state);
-                unit_sub_state_label.set_text_or_na(unit.sub_state);
+                if (bulk)
+                        end_unit_bulk_update();
+        }
 
-                string fp = unit.fragment_path;
-                if (fp != "")
-                        unit_fragment_path_label.set_markup_or_na(
-                                "<a href=\"file://" + fp +"\">" +
-                                "<span underline='none' color='black'>" + fp + "</span></a>");
-                else
-                        unit_fragment_path_label.set_text_or_na();
+        /* Same as populate_unit_model() for the job list */
+        public void populate_job_model() throws DBusError, IOError {
+                var list = manager.list_jobs();
 
+                Gee.HashSet<string> listed = new Gee.HashSet<string>();
+                foreach (var i in list)
+                        listed.add(i.job_path);
 
-                unit_active_enter_timestamp_label.set_text_or_na(format_time(unit.active_enter_timestamp));
+                string[] removed = {};
+                uint32[] removed_ids = {};
 
-                unit_active_exit_timestamp_label.set_text_or_na(format_time(unit.active_exit_timestamp));
+                HashTableIter<string, TreeIter?> r = HashTableIter<string, TreeIter?>(job_rows);
+                unowned string path;
+                unowned TreeIter? j;
 
-                bool b = unit.can_start;
-                start_button.set_sensitive(b);
-                stop_button.set_sensitive(b);
-                restart_button.set_sensitive(b);
-                unit_can_start_label.set_text_or_na(b ? "Yes" : "No");
+                while (r.next(out path, out j)) {
+                        if (path in listed)
+                                continue;
 
-                b = unit.can_reload;
-                reload_button.set_sensitive(b);
-                unit_can_reload_label.set_text_or_na(b ? "Yes" : "No");
+                        uint32 id;
+                        job_model.get(j, 5, out id);
+                        removed += path;
+                        removed_ids += id;
+                }
 
-                unit_cgroup_label.set_text_or_na(unit.default_control_group);
+                for (int n = 0; n < removed.length; n++)
+                        remove_job(removed_ids[n], removed[n]);
+
+                foreach (var i in list) {
+                        j = job_rows[i.job_path];
+                        TreeIter iter;
+
+                        if (j != null)
+                                iter = j;
+                        else {
+                                job_model.append(out iter);
+                                job_rows[i.job_path] = iter;
+                        }
+
+                        job_model.set(iter,
+                                      0, "%u".printf(i.id),
+                                      1, i.name,
+                                      2, i.type,
+                                      3, i.state,
+                                      4, i.job_path,
+                                      5, i.id);
+                }
         }
 
-        public Job? get_current_job() {
-                TreePath p;
-                job_view.get_cursor(out p, null);
+        /* Enablement comes from the unit file list, there is no column
+         * for it in the unit model. Empty until the list is loaded. */
+        private void new_unit_file_state_column() {
+                TreeViewColumn col = new TreeViewColumn();
+                CellRendererText renderer = new CellRendererText();
 
-                if (p == null)
-                        return null;
+                col.set_title("File State");
+                col.pack_start(renderer, true);
+                col.set_cell_data_func(renderer, (c, cell, model, iter) => {
+                        string id;
+                        model.get(iter, 0, out id);
+                        ((CellRendererText) cell).text = unit_file_states[id];
+                });
+                unit_view.insert_column(col, -1);
+        }
 
-                TreeIter iter;
-                TreeModel model = job_view.get_model();
-                Job *j;
+        /* The pattern only narrows down the tab, the join with the unit
+         * list always needs every unit file */
+        private bool unit_file_filter_func(TreeModel model, TreeIter iter) {
+                string name;
 
-                model.get_iter(out iter, p);
-                model.get(iter, 4, out j);
+                if (unit_file_pattern == null)
+                        return true;
 
-                return j;
+                model.get(iter, 0, out name);
+                return name != null && unit_file_pattern.match_string(name);
         }
 
-        public void job_changed() {
-                Job j = get_current_job();
+        public void unit_file_pattern_changed() {
+                string pattern = unit_file_pattern_entry.get_text();
 
-                if (j == null)
-                        clear_job();
-                else
-                        show_job(j);
+                unit_file_pattern = pattern == "" ? null : new PatternSpec(pattern);
+                unit_file_filter.refilter();
+                update_unit_file_status();
         }
 
-        public void clear_job() {
-                current_job_id = 0;
+        private void update_unit_file_status() {
+                int shown = unit_file_filter.iter_n_children(null);
+                int total = unit_file_model.iter_n_children(null);
 
-                job_id_label.set_text_or_na();
-                job_state_label.set_text_or_na();
-                job_type_label.set_text_or_na();
+                if (unit_file_pattern == null)
+                        unit_file_status_label.set_text("%d unit files".printf(total));
+                else
+                        unit_file_status_label.set_text("%d of %d unit files".printf(shown, total));
+        }
 
-                cancel_button.set_sensitive(false);
+        /* One ListUnitFiles call for the tab and the join with the unit
+         * list, instead of a GetUnitFileState per unit */
+        public void populate_unit_file_model() {
+                fetch_unit_files.begin();
+        }
+
+        /* Reading the unit directories takes PID 1 a while on big
+         * hosts, the UI goes on meanwhile. Only the latest reply is
+         * applied. */
+        private async void fetch_unit_files() {
+                uint serial = ++unit_file_fetch_serial;
+                Manager.UnitFileInfo[] list;
+
+                unit_files_loaded = true;
+
+                try {
+                        list = yield manager.list_unit_files();
+                } catch (Error e) {
+                        if (serial == unit_file_fetch_serial)
+                                show_error(e);
+                        return;
+                }
+
+                if (serial != unit_file_fetch_serial)
+                        return;
+
+                unit_file_view.set_model(null);
+                unit_file_model.clear();
+                unit_file_states.remove_all();
+
+                foreach (var i in list) {
+                        TreeIter iter;
+                        string name = Path.get_basename(i.path);
+
+                        unit_file_model.append(out iter);
+                        unit_file_model.set(iter,
+                                            0, name,
+                                            1, i.state,
+                                            2, i.path);
+
+                        /* The first path found wins, like in systemd */
+                        if (!unit_file_states.contains(name))
+                                unit_file_states[name] = i.state;
+                }
+
+                unit_file_model.set_sort_column_id(0, SortType.ASCENDING);
+                unit_file_view.set_model(unit_file_filter);
+
+                unit_file_pattern_changed();
+                unit_view.queue_draw();
+        }
+
+        public void on_unit_files_changed() {
+                if (unit_files_loaded)
+                        populate_unit_file_model();
+        }
+
+        /* PID 1 re-executed or came back on the bus: subscribe again and
+         * catch up with whatever changed in the meantime */
+        public void on_manager_owner_changed() {
+                if (manager.get_name_owner() == null)
+                        return;
+
+                try {
+                        manager.subscribe();
+                } catch (Error e) {
+                        show_error(e);
+                }
+
+                /* If the old instance went away in the middle of a
+                 * reload its Reloading(false) never comes */
+                on_reloading(false);
+        }
+
+        public string? get_current_unit_path() {
+                TreePath p;
+                unit_view.get_cursor(out p, null);
+
+                if (p == null)
+                        return null;
+
+                TreeModel model = unit_view.get_model();
+                TreeIter iter;
+                string path;
+
+                model.get_iter(out iter, p);
+                model.get(iter, 6, out path);
+
+                return path;
+        }
+
+        public Unit? get_current_unit() {
+                string? path = get_current_unit_path();
+
+                if (path == null)
+                        return null;
+
+                return get_unit_proxy(path);
+        }
+
+        public Unit? get_unit_proxy(string path) {
+                if (current_unit != null && current_unit.get_object_path() == path)
+                        return current_unit;
+
+                try {
+                        Unit u = Bus.get_proxy_sync(
+                                        user ? BusType.SESSION : BusType.SYSTEM,
+                                        "org.freedesktop.systemd1",
+                                        path);
+
+                        return u;
+                } catch (Error e) {
+                        show_error(e);
+                }
+
+                return null;
+        }
+
+        public void unit_changed() {
+                if (unit_view_detached)
+                        return;
+
+                /* The same unit again, like the cursor put back after a
+                 * bulk update, keeps its detail pane as it is */
+                string? path = get_current_unit_path();
+                if (path != null && current_unit != null && current_unit.get_object_path() == path)
+                        return;
+
+                show_current_unit();
+        }
+
+        public void show_current_unit() {
+                Unit u = get_current_unit();
+
+                if (u == null)
+                        clear_unit();
+                else
+                        show_unit(u);
+        }
+
+        public void clear_unit() {
+                current_unit_id = null;
+                current_unit = null;
+                current_can_start = false;
+                current_can_reload = false;
+
+                update_unit_action_buttons();
+
+                unit_id_label.set_text_or_na();
+                unit_description_label.set_text_or_na();
+                unit_description_label.set_text_or_na();
+                unit_load_state_label.set_text_or_na();
+                unit_active_state_label.set_text_or_na();
+                unit_sub_state_label.set_text_or_na();
+                unit_fragment_path_label.set_text_or_na();
+                unit_active_enter_timestamp_label.set_text_or_na();
+                unit_active_exit_timestamp_label.set_text_or_na();
+                unit_can_reload_label.set_text_or_na();
+                unit_can_start_label.set_text_or_na();
+                unit_cgroup_label.set_text_or_na();
+
+                show_dependencies(new DependencyRelation[0]);
+                fetch_link_states.begin(new string[0]);
+        }
+
+        /* The colour and sub-state come from the unit model, or for
+         * units the filters leave out from fetch_link_states(), so this
+         * does not touch any proxy */
+        public void append_unit_link(StringBuilder b, string i, bool link) {
+                TreeIter iter;
+                SubState sub_state;
+                int s;
+
+                if (unit_model.lookup_id(i, out iter))
+                        sub_state = unit_model.get_sub_state(iter);
+                else if (link_sub_states.lookup_extended(i, null, out s))
+                        sub_state = (SubState) s;
+                else {
+                        if (link)
+                                b.append_c(' ');
+                        b.append("<span color='grey'>").append(i).append("</span>");
+                        return;
+                }
+
+                unowned string color;
+                switch (sub_state) {
+                case SubState.ACTIVE: color = "blue"; break;
+                case SubState.DEAD: color = "black"; break;
+                case SubState.RUNNING: color = "green"; break;
+                case SubState.PLUGGED: color = "light blue"; break;
+                case SubState.MOUNTED: color = "light green"; break;
+                case SubState.EXITED: color = "brown"; break;
+                case SubState.FAILED: color = "red"; break;
+                default: color = "black"; break;
+                }
+
+                if (link)
+                        b.append(" <a href='").append(i).append("'>");
+
+                b.append("<span underline='none' color='").append(color).append("'>")
+                 .append(i).append_c('(')
+                 .append(unit_model.sub_states.get_name(sub_state))
+                 .append(")</span>");
+
+                if (link)
+                        b.append("</a>");
+        }
+
+        /* One ListUnitsByNames call for the linked units the unit model
+         * does not have. Without it, on older systemd, they stay grey. */
+        private async void fetch_link_states(string[] ids) {
+                uint serial = ++link_fetch_serial;
+                Manager.UnitInfo[] list = {};
+
+                link_sub_states.remove_all();
+                link_ids.remove_all();
+
+                if (ids.length == 0)
+                        return;
+
+                try {
+                        list = yield manager.list_units_by_names(ids);
+                } catch (Error e) {
+                        return;
+                }
+
+                if (serial != link_fetch_serial)
+                        return;
+
+                foreach (var i in list) {
+                        link_sub_states[i.id] = unit_model.sub_states.intern(i.sub_state);
+                        link_ids[i.unit_path] = i.id;
+                }
+
+                refresh_unit_links();
+        }
+
+        /* Renders the links of the detail pane again, keeping the
+         * expanded relations as they are */
+        private void refresh_unit_links() {
+                if (current_unit == null)
+                        return;
+
+                unit_id_label.set_markup_or_na(format_unit_id(current_unit));
+
+                StringBuilder b = new StringBuilder();
+
+                dependency_store.foreach((model, p, iter) => {
+                        string? id;
+
+                        dependency_store.get(iter, 1, out id);
+                        if (id == null)
+                                return false;
+
+                        b.truncate(0);
+                        append_unit_link(b, id, false);
+                        dependency_store.set(iter, 0, b.str);
+
+                        return false;
+                });
+        }
+
+        public string format_unit_link(string i, bool link) {
+                StringBuilder b = new StringBuilder();
+                append_unit_link(b, i, link);
+                return b.str;
+        }
+
+        public void show_dependencies(DependencyRelation[] relations) {
+                dependency_store.clear();
+                dependency_relations = relations;
+
+                /* One builder for all rows, the markup is copied into
+                 * the store anyway */
+                StringBuilder b = new StringBuilder();
+
+                for (int n = 0; n < relations.length; n++) {
+                        if (relations[n].units.length == 0)
+                                continue;
+
+                        TreeIter iter, child;
+
+                        b.truncate(0);
+                        b.append("<b>").append(relations[n].word).append("</b> (")
+                         .append(relations[n].units.length.to_string()).append_c(')');
+
+                        dependency_store.append(out iter, null);
+                        dependency_store.set(iter,
+                                             0, b.str,
+                                             1, null,
+                                             2, n);
+
+                        /* Placeholder so that the row gets an expander */
+                        dependency_store.append(out child, iter);
+                        dependency_store.set(child, 0, "", 1, null, 2, -1);
+                }
+        }
+
+        /* Replaces the placeholder with the units of the relation */
+        public bool on_dependency_expand(TreeIter iter, TreePath path) {
+                int n;
+                TreeIter child;
+                string? id;
+
+                dependency_store.get(iter, 2, out n);
+                if (n < 0 || !dependency_store.iter_children(out child, iter))
+                        return false;
+
+                dependency_store.get(child, 1, out id);
+                if (id != null)
+                        return false;
+
+                dependency_store.remove(ref child);
+
+                StringBuilder b = new StringBuilder();
+
+                foreach (unowned string i in dependency_relations[n].units) {
+                        b.truncate(0);
+                        append_unit_link(b, i, false);
+
+                        dependency_store.append(out child, iter);
+                        dependency_store.set(child,
+                                             0, b.str,
+                                             1, i,
+                                             2, -1);
+                }
+
+                return false;
+        }
+
+        public void on_dependency_activated(TreePath path, TreeViewColumn? column) {
+                TreeIter iter;
+                string? id;
+
+                if (!dependency_store.get_iter(out iter, path))
+                        return;
+
+                dependency_store.get(iter, 1, out id);
+
+                if (id != null)
+                        on_activate_link(id);
+                else if (unit_dependency_view.is_row_expanded(path))
+                        unit_dependency_view.collapse_row(path);
+                else
+                        unit_dependency_view.expand_row(path, false);
+        }
+
+        public string format_unit_id(Unit unit) {
+                string id_display = format_unit_link(unit.id, false);
+                bool has_alias = false;
+                foreach (string i in unit.names) {
+                        if (i == unit.id)
+                                continue;
+
+                        if (!has_alias) {
+                                id_display += " (aliases:";
+                                has_alias = true;
+                        }
+
+                        id_display += " " + i;
+                }
+                if(has_alias)
+                        id_display += ")";
+
+                return id_display;
+        }
+
+        public void show_unit(Unit unit) {
+                current_unit_id = unit.id;
+                current_unit = unit;
+
+                unit_id_label.set_markup_or_na(format_unit_id(unit));
+
+                DependencyRelation[] relations = {
+                        new DependencyRelation("requires", unit.requires),
+                        new DependencyRelation("overridable requires", unit.requires_overridable),
+                        new DependencyRelation("requisite", unit.requisite),
+                        new DependencyRelation("overridable requisite", unit.requisite_overridable),
+                        new DependencyRelation("wants", unit.wants),
+                        new DependencyRelation("conflicts", unit.conflicts),
+                        new DependencyRelation("required by", unit.required_by),
+                        new DependencyRelation("overridable required by", unit.required_by_overridable),
+                        new DependencyRelation("wanted by", unit.wanted_by),
+                        new DependencyRelation("after", unit.after),
+                        new DependencyRelation("before", unit.before)
+                };
+
+                show_dependencies(relations);
+
+                string[] missing = {};
+                TreeIter iter;
+
+                if (!unit_model.lookup_id(unit.id, out iter))
+                        missing += unit.id;
+
+                foreach (var r in relations)
+                        foreach (unowned string i in r.units)
+                                if (!unit_model.lookup_id(i, out iter))
+                                        missing += i;
+
+                fetch_link_states.begin(missing);
+
+                unit_description_label.set_text_or_na(unit.description);
+                unit_load_state_label.set_text_or_na(unit.load_state);
+                unit_active_state_label.set_text_or_na(unit.active_state);
+                unit_sub_state_label.set_text_or_na(unit.sub_state);
+
+                show_fragment_path(unit.fragment_path);
+
+                unit_active_enter_timestamp_label.set_text_or_na(format_time(unit.active_enter_timestamp));
+
+                unit_active_exit_timestamp_label.set_text_or_na(format_time(unit.active_exit_timestamp));
+
+                show_can_start(unit.can_start);
+                show_can_reload(unit.can_reload);
+
+                unit_cgroup_label.set_text_or_na(unit.default_control_group);
+        }
+
+        public void show_fragment_path(string fp) {
+                if (fp != "")
+                        unit_fragment_path_label.set_markup_or_na(
+                                "<a href=\"file://" + fp +"\">" +
+                                "<span underline='none' color='black'>" + fp + "</span></a>");
+                else
+                        unit_fragment_path_label.set_text_or_na();
+        }
+
+        public void show_can_start(bool b) {
+                current_can_start = b;
+                update_unit_action_buttons();
+                unit_can_start_label.set_text_or_na(b ? "Yes" : "No");
+        }
+
+        public void show_can_reload(bool b) {
+                current_can_reload = b;
+                update_unit_action_buttons();
+                unit_can_reload_label.set_text_or_na(b ? "Yes" : "No");
+        }
+
+        /* With several units selected the buttons act on all of them,
+         * so they do not follow the unit shown. With one they do, with
+         * none there is nothing to act on. */
+        private void update_unit_action_buttons() {
+                int n = unit_view.get_selection().count_selected_rows();
+                bool start = n > 1 || (n == 1 && current_unit != null && current_can_start);
+                bool reload = n > 1 || (n == 1 && current_unit != null && current_can_reload);
+
+                start_button.set_sensitive(start);
+                stop_button.set_sensitive(start);
+                restart_button.set_sensitive(start);
+                reload_button.set_sensitive(reload);
+        }
+
+        public void unit_selection_changed() {
+                if (unit_view_detached)
+                        return;
+
+                update_reset_failed_button();
+                update_unit_action_buttons();
+        }
+
+        /* Sensitive while any selected unit is failed */
+        private void update_reset_failed_button() {
+                TreeModel model;
+                List<TreePath> rows = unit_view.get_selection().get_selected_rows(out model);
+                bool failed = false;
+
+                foreach (unowned TreePath p in rows) {
+                        TreeIter iter;
+                        int state;
+
+                        model.get_iter(out iter, p);
+                        model.get(iter, 3, out state);
+
+                        if (state == ActiveState.FAILED) {
+                                failed = true;
+                                break;
+                        }
+                }
+
+                reset_failed_button.set_sensitive(failed);
+        }
+
+        /* Updates the detail pane from a property of the unit shown there */
+        public void show_unit_property(string name, Variant value) {
+                switch (name) {
+                case "Description":
+                        unit_description_label.set_text_or_na(value.get_string());
+                        break;
+                case "LoadState":
+                        unit_load_state_label.set_text_or_na(value.get_string());
+                        break;
+                case "ActiveState":
+                        unit_active_state_label.set_text_or_na(value.get_string());
+                        break;
+                case "SubState":
+                        unit_sub_state_label.set_text_or_na(value.get_string());
+                        if (current_unit != null)
+                                unit_id_label.set_markup_or_na(format_unit_id(current_unit));
+                        break;
+                case "FragmentPath":
+                        show_fragment_path(value.get_string());
+                        break;
+                case "ActiveEnterTimestamp":
+                        unit_active_enter_timestamp_label.set_text_or_na(format_time(value.get_uint64()));
+                        break;
+                case "ActiveExitTimestamp":
+                        unit_active_exit_timestamp_label.set_text_or_na(format_time(value.get_uint64()));
+                        break;
+                case "CanStart":
+                        show_can_start(value.get_boolean());
+                        break;
+                case "CanReload":
+                        show_can_reload(value.get_boolean());
+                        break;
+                case "DefaultControlGroup":
+                        unit_cgroup_label.set_text_or_na(value.get_string());
+                        break;
+                }
+        }
+
+        public static bool is_unit_property_shown(string name) {
+                switch (name) {
+                case "Description":
+                case "LoadState":
+                case "ActiveState":
+                case "SubState":
+                case "Job":
+                case "FragmentPath":
+                case "ActiveEnterTimestamp":
+                case "ActiveExitTimestamp":
+                case "CanStart":
+                case "CanReload":
+                case "DefaultControlGroup":
+                        return true;
+                default:
+                        return false;
+                }
+        }
+
+        public Job? get_current_job() {
+                TreePath p;
+                job_view.get_cursor(out p, null);
+
+                if (p == null)
+                        return null;
+
+                TreeIter iter;
+                TreeModel model = job_view.get_model();
+                string path;
+
+                model.get_iter(out iter, p);
+                model.get(iter, 4, out path);
+
+                try {
+                        Job j = Bus.get_proxy_sync(
+                                        user ? BusType.SESSION : BusType.SYSTEM,
+                                        "org.freedesktop.systemd1",
+                                        path);
+
+                        return j;
+                } catch (Error e) {
+                        show_error(e);
+                }
+
+                return null;
+        }
+
+        public void job_changed() {
+                Job j = get_current_job();
+
+                if (j == null)
+                        clear_job();
+                else
+                        show_job(j);
+        }
+
+        public void clear_job() {
+                current_job_id = 0;
+
+                job_id_label.set_text_or_na();
+                job_state_label.set_text_or_na();
+                job_type_label.set_text_or_na();
+
+                cancel_button.set_sensitive(false);
         }
 
         public void show_job(Job job) {
@@ -660,328 +1777,923 @@ public class MainWindow : Window {
                 cancel_button.set_sensitive(true);
         }
 
-        public void on_start() {
-                Unit u = get_current_unit();
+        /* The object paths of the selected units, or of the one under
+         * the cursor if none is selected */
+        public string[] get_selected_unit_paths() {
+                TreeModel model;
+                List<TreePath> rows = unit_view.get_selection().get_selected_rows(out model);
+                string[] paths = {};
+
+                foreach (unowned TreePath p in rows) {
+                        TreeIter iter;
+                        string path;
+
+                        model.get_iter(out iter, p);
+                        model.get(iter, 6, out path);
+                        paths += path;
+                }
+
+                if (paths.length == 0) {
+                        string? path = get_current_unit_path();
+                        if (path != null)
+                                paths += path;
+                }
+
+                return paths;
+        }
+
+        public void on_start() {
+                run_unit_actions(get_selected_unit_paths(), UnitAction.START);
+        }
+
+        public void on_stop() {
+                run_unit_actions(get_selected_unit_paths(), UnitAction.STOP);
+        }
+
+        public void on_reload() {
+                run_unit_actions(get_selected_unit_paths(), UnitAction.RELOAD);
+        }
+
+        public void on_restart() {
+                run_unit_actions(get_selected_unit_paths(), UnitAction.RESTART);
+        }
+
+        public void on_reset_failed() {
+                run_unit_actions(get_selected_unit_paths(), UnitAction.RESET_FAILED);
+        }
+
+        public void on_rolling_restart() {
+                string[] paths = get_selected_unit_paths();
+                string[] ids = {};
+
+                if (paths.length == 0)
+                        return;
+
+                foreach (string path in paths) {
+                        TreeIter iter;
+                        ids += unit_model.lookup_path(path, out iter) ? unit_model.get_id(iter) : path;
+                }
+
+                RollingRestartDialog d = new RollingRestartDialog(this, bus, manager, ids, paths);
+                d.show();
+        }
+
+        public void on_cancel() {
+                TreePath p;
+                job_view.get_cursor(out p, null);
+
+                if (p == null)
+                        return;
+
+                TreeIter iter;
+                string path;
+
+                job_model.get_iter(out iter, p);
+                job_model.get(iter, 4, out path);
+
+                cancel_job.begin(path);
+        }
+
+        private Cancellable begin_call() {
+                if (pending_calls++ == 0)
+                        stop_waiting_button.set_sensitive(true);
+
+                return call_cancellable;
+        }
+
+        private void end_call() {
+                if (--pending_calls == 0)
+                        stop_waiting_button.set_sensitive(false);
+        }
+
+        /* Gives up on the replies, whatever systemd already queued
+         * stays queued */
+        public void on_stop_waiting() {
+                call_cancellable.cancel();
+                call_cancellable = new Cancellable();
+        }
+
+        public void show_status(string text) {
+                statusbar.remove_all(statusbar_context);
+                statusbar.push(statusbar_context, text);
+        }
+
+        /* Sends the calls for all units without waiting for any reply,
+         * so a batch takes about one round trip however large it is */
+        public void run_unit_actions(string[] paths, UnitAction action) {
+                if (paths.length == 0)
+                        return;
+
+                BatchAction b = new BatchAction(action, paths.length);
+
+                if (paths.length == 1) {
+                        TreeIter iter;
+                        if (unit_model.lookup_path(paths[0], out iter))
+                                b.unit_id = unit_model.get_id(iter);
+                }
+
+                foreach (string path in paths)
+                        run_unit_action.begin(path, b);
+
+                show_batch_status(b);
+        }
+
+        /* Called on the connection directly, a proxy per unit would cost
+         * a match rule and a name owner lookup each */
+        private async void run_unit_action(string path, BatchAction b) {
+                Cancellable c = begin_call();
+
+                try {
+                        Variant reply = yield bus.call(
+                                        "org.freedesktop.systemd1",
+                                        path,
+                                        "org.freedesktop.systemd1.Unit",
+                                        b.action.get_method(),
+                                        b.action.queues_job() ? new Variant("(s)", "replace") : null,
+                                        b.action.queues_job() ? new VariantType("(o)") : null,
+                                        DBusCallFlags.NONE,
+                                        -1,
+                                        c);
+
+                        if (b.action.queues_job())
+                                track_job(path, reply.get_child_value(0).get_string(), b);
+                } catch (IOError.CANCELLED e) {
+                        /* Stopped waiting, not an error of the unit */
+                } catch (Error e) {
+                        TreeIter iter;
+                        string id = unit_model.lookup_path(path, out iter) ? unit_model.get_id(iter) : path;
+
+                        b.errors += "%s: %s".printf(id, e.message);
+                }
+
+                end_call();
+
+                if (++b.replies == b.units)
+                        finish_batch(b);
+                else
+                        show_batch_status(b);
+        }
+
+        /* Shows the job in the unit row right away, PropertiesChanged
+         * will confirm it */
+        private void track_job(string unit_path, string job_path, BatchAction b) {
+                TreeIter iter;
+
+                if (!unit_model.lookup_path(unit_path, out iter))
+                        return;
+
+                tracked_jobs[job_path] = new TrackedJob(unit_model.get_id(iter), b);
+                b.jobs++;
+
+                if (unit_model.get_job(iter) == JobType.NONE)
+                        unit_model.set_column(iter, 5, b.action.get_verb());
+        }
+
+        private void finish_batch(BatchAction b) {
+                show_batch_status(b);
+
+                if (b.errors.length == 0)
+                        return;
+
+                /* One dialog for the whole batch, not one per unit */
+                string[] shown = b.errors.length > 20 ? b.errors[0:20] : b.errors;
+                string text = string.joinv("\n", shown);
+
+                if (shown.length < b.errors.length)
+                        text += "\n… and %d more".printf(b.errors.length - shown.length);
+
+                var m = new MessageDialog(this,
+                                          DialogFlags.DESTROY_WITH_PARENT,
+                                          MessageType.ERROR,
+                                          ButtonsType.CLOSE, "%s",
+                                          "Could not %s %d of %d units".printf(
+                                                  b.action.get_verb(), b.errors.length, b.units));
+                m.title = "Error";
+                m.format_secondary_text("%s", text);
+                m.run();
+                m.destroy();
+        }
+
+        private void show_batch_status(BatchAction b) {
+                string what = b.unit_id != null ?
+                        "%s of %s".printf(b.action.get_verb(), b.unit_id) :
+                        "%s of %d units".printf(b.action.get_verb(), b.units);
+
+                if (b.replies < b.units)
+                        show_status("Sent %s, %d replies so far".printf(what, b.replies));
+                else if (!b.action.queues_job())
+                        show_status("Done %s, %d failed".printf(what, b.errors.length));
+                else if (b.jobs_finished < b.jobs)
+                        show_status("Queued %s, %d of %d jobs finished".printf(what, b.jobs_finished, b.jobs));
+                else if (b.unit_id != null && b.jobs == 1)
+                        show_status("Finished %s: %s".printf(what, b.jobs_failed == 0 ? "done" : "failed"));
+                else
+                        show_status("Finished %s, %d failed".printf(what, b.jobs_failed + b.errors.length));
+        }
 
-                if (u == null)
-                        return;
+        private async void cancel_job(string path) {
+                Cancellable c = begin_call();
 
                 try {
-                        u.start("replace");
+                        Job j = yield Bus.get_proxy(
+                                        user ? BusType.SESSION : BusType.SYSTEM,
+                                        "org.freedesktop.systemd1",
+                                        path,
+                                        DBusProxyFlags.DO_NOT_LOAD_PROPERTIES | DBusProxyFlags.DO_NOT_CONNECT_SIGNALS,
+                                        c);
+                        yield j.cancel(c);
+                } catch (IOError.CANCELLED e) {
+                        /* Stopped waiting */
                 } catch (Error e) {
                         show_error(e);
                 }
-        }
 
-        public void on_stop() {
-                Unit u = get_current_unit();
+                end_call();
+        }
 
-                if (u == null)
-                        return;
+        private async Variant get_all_properties(string path, string iface) throws Error {
+                Variant reply = yield bus.call(
+                                "org.freedesktop.systemd1",
+                                path,
+                                "org.freedesktop.DBus.Properties",
+                                "GetAll",
+                                new Variant("(s)", iface),
+                                new VariantType("(a{sv})"),
+                                DBusCallFlags.NONE,
+                                -1);
+
+                return reply.get_child_value(0);
+        }
 
-                try {
-                        u.stop("replace");
-                } catch (Error e) {
-                        show_error(e);
-                }
+        private async Variant get_property(string path, string iface, string name) throws Error {
+                Variant reply = yield bus.call(
+                                "org.freedesktop.systemd1",
+                                path,
+                                "org.freedesktop.DBus.Properties",
+                                "Get",
+                                new Variant("(ss)", iface, name),
+                                new VariantType("(v)"),
+                                DBusCallFlags.NONE,
+                                -1);
+
+                return reply.get_child_value(0).get_variant();
         }
 
-        public void on_reload() {
-                Unit u = get_current_unit();
+        public void set_unit_property(TreeIter iter, string name, Variant value) {
+                int t = DependencyGraph.type_from_property(name);
 
-                if (u == null)
+                if (t >= 0) {
+                        if (dependency_graph_loaded)
+                                dependency_graph.set_edges(unit_model.get_id(iter), (DependencyType) t, value.dup_strv());
                         return;
+                }
 
-                try {
-                        u.reload("replace");
-                } catch (Error e) {
-                        show_error(e);
+                switch (name) {
+                case "Description":
+                        unit_model.set_column(iter, 1, value.get_string());
+                        break;
+                case "LoadState":
+                        unit_model.set_column(iter, 2, value.get_string());
+                        break;
+                case "ActiveState":
+                        unit_model.set_column(iter, 3, value.get_string());
+
+                        /* A selected unit failed, or was reset */
+                        if (!unit_view_detached) {
+                                TreePath? p = get_unit_view_path(unit_model.get_id(iter));
+
+                                if (p != null && unit_view.get_selection().path_is_selected(p))
+                                        update_reset_failed_button();
+                        }
+                        break;
+                case "SubState":
+                        unit_model.set_column(iter, 4, value.get_string());
+                        break;
+                case "Job":
+                        set_unit_job(iter, value);
+                        break;
                 }
         }
 
-        public void on_restart() {
-                Unit u = get_current_unit();
+        public void set_unit_job(TreeIter iter, Variant job) {
+                uint32 job_id = job.get_child_value(0).get_uint32();
+                string job_path = job.get_child_value(1).get_string();
+                string? t = null;
 
-                if (u == null)
-                        return;
+                if (job_id != 0) {
+                        unowned TreeIter? j = job_rows[job_path];
 
-                try {
-                        u.restart("replace");
-                } catch (Error e) {
-                        show_error(e);
+                        if (j != null)
+                                job_model.get(j, 2, out t);
+
+                        /* The job row is still being filled in */
+                        if (t == null)
+                                fetch_unit_job_type.begin(unit_model.get_object_path(iter), job_path);
                 }
+
+                unit_model.set_column(iter, 5, t != null ? t : "");
         }
 
-        public void on_cancel() {
-                Job j = get_current_job();
+        private async void fetch_unit_job_type(string path, string job_path) {
+                try {
+                        Variant t = yield get_property(job_path, "org.freedesktop.systemd1.Job", "JobType");
 
-                if (j == null)
-                        return;
+                        TreeIter iter;
 
-                try {
-                        j.cancel();
+                        if (unit_model.lookup_path(path, out iter))
+                                unit_model.set_column(iter, 5, t.get_string());
                 } catch (Error e) {
-                        show_error(e);
+                        /* The job finished in the meantime */
                 }
         }
 
-        public void update_unit_iter(TreeIter iter, string id, Unit u) {
+        public void apply_unit_properties(string path, TreeIter iter, HashTable<string, Variant?> properties) {
+                bool current = current_unit_id == unit_model.get_id(iter);
 
-                try  {
-                        string t = "";
-                        Unit.JobLink jl = u.job;
+                HashTableIter<string, Variant?> i = HashTableIter<string, Variant?>(properties);
+                unowned string name;
+                unowned Variant? value;
 
-                        if (jl.id != 0) {
-                                Job j = Bus.get_proxy_sync(
-                                                user ? BusType.SESSION : BusType.SYSTEM,
-                                                "org.freedesktop.systemd1",
-                                                jl.path);
+                while (i.next(out name, out value)) {
 
-                                t = j.job_type;
+                        /* Invalidated properties come without a value,
+                         * fetch those we actually show */
+                        if (value == null) {
+                                if (is_unit_property_shown(name) ||
+                                    (dependency_graph_loaded && DependencyGraph.type_from_property(name) >= 0))
+                                        fetch_property.begin(path, false, name);
+                                continue;
                         }
 
-                        unit_model.set(iter,
-                                       0, id,
-                                       1, u.description,
-                                       2, u.load_state,
-                                       3, u.active_state,
-                                       4, u.sub_state,
-                                       5, t != "" ? "→ %s".printf(t) : "",
-                                       6, u);
-                } catch (Error e) {
-                        show_error(e);
+                        set_unit_property(iter, name, value);
+
+                        if (current)
+                                show_unit_property(name, value);
                 }
         }
 
-        public void on_unit_new(string id, ObjectPath path) {
-                try {
+        public void set_job_property(TreeIter iter, string name, Variant value) {
+                switch (name) {
+                case "Unit":
+                        job_model.set(iter, 1, value.get_child_value(0).get_string());
+                        break;
+                case "JobType":
+                        job_model.set(iter, 2, value.get_string());
+                        break;
+                case "State":
+                        job_model.set(iter, 3, value.get_string());
+                        break;
+                }
+        }
 
-                        Properties p = Bus.get_proxy_sync(
-                                        user ? BusType.SESSION : BusType.SYSTEM,
-                                        "org.freedesktop.systemd1",
-                                        path);
+        public void apply_job_properties(TreeIter iter, HashTable<string, Variant?> properties) {
+                uint32 id;
+                job_model.get(iter, 5, out id);
 
-                        p.properties_changed.connect(on_unit_changed);
+                bool current = current_job_id == id;
 
-                        TreeIter iter;
-                        unit_model.append(out iter);
+                HashTableIter<string, Variant?> i = HashTableIter<string, Variant?>(properties);
+                unowned string name;
+                unowned Variant? value;
 
-                        Unit u = Bus.get_proxy_sync(
-                                        user ? BusType.SESSION : BusType.SYSTEM,
-                                        "org.freedesktop.systemd1",
-                                        path);
+                while (i.next(out name, out value)) {
+                        if (value == null)
+                                continue;
 
-                        unit_map[id] = u;
+                        set_job_property(iter, name, value);
 
-                        update_unit_iter(iter, id, u);
-                } catch (Error e) {
-                        show_error(e);
+                        if (!current)
+                                continue;
+
+                        if (name == "State")
+                                job_state_label.set_text_or_na(value.get_string());
+                        else if (name == "JobType")
+                                job_type_label.set_text_or_na(value.get_string());
                 }
         }
 
-        public void update_job_iter(TreeIter iter, uint32 id, Job j) {
-                job_model.set(iter,
-                              0, "%u".printf(id),
-                              1, j.unit.id,
-                              2, "→ %s".printf(j.job_type),
-                              3, j.state,
-                              4, j,
-                              5, id);
+        private PendingUpdate get_pending_update(string path, bool job) {
+                PendingUpdate? u = pending_updates[path];
+
+                if (u == null) {
+                        u = new PendingUpdate(path, job);
+                        pending_updates[path] = u;
+                        pending_queue.push_tail(u);
+
+                        if (flush_tick == 0 && !reloading)
+                                flush_tick = add_tick_callback(flush_pending_updates);
+                }
+
+                return u;
         }
 
-        public void on_job_new(uint32 id, ObjectPath path) {
+        private void queue_properties(string path, bool job, Variant changed_properties, string[] invalidated_properties) {
+                PendingUpdate u = get_pending_update(path, job);
 
-                try  {
+                if (u.operation == UpdateOperation.REMOVE)
+                        return;
 
-                        Properties p = Bus.get_proxy_sync(
-                                        user ? BusType.SESSION : BusType.SYSTEM,
-                                        "org.freedesktop.systemd1",
-                                        path);
+                VariantIter i = changed_properties.iterator();
+                string name;
+                Variant value;
 
-                        p.properties_changed.connect(on_job_changed);
+                while (i.next("{sv}", out name, out value))
+                        u.properties[name] = value;
 
-                        TreeIter iter;
-                        job_model.append(out iter);
+                foreach (string n in invalidated_properties)
+                        u.properties[n] = null;
+        }
 
-                        Job j = Bus.get_proxy_sync(
-                                        user ? BusType.SESSION : BusType.SYSTEM,
-                                        "org.freedesktop.systemd1",
-                                        path);
+        private bool flush_pending_updates(Widget widget, Gdk.FrameClock frame_clock) {
+                PendingUpdate? u;
+                bool bulk = pending_queue.length > BULK_UPDATE_THRESHOLD ||
+                            unit_model.needs_compaction();
 
-                        update_job_iter(iter, id, j);
+                if (bulk)
+                        begin_unit_bulk_update();
 
-                } catch (Error e) {
-                        show_error(e);
+                while ((u = pending_queue.pop_head()) != null) {
+                        if (u.job)
+                                flush_job_update(u);
+                        else
+                                flush_unit_update(u);
                 }
+
+                if (bulk)
+                        end_unit_bulk_update();
+
+                pending_updates.remove_all();
+                flush_tick = 0;
+
+                return false;
         }
 
-        public void on_unit_removed(string id, ObjectPath path) {
-                TreeIter iter;
-                if (!(unit_model.get_iter_first(out iter)))
+        private void flush_unit_update(PendingUpdate u) {
+                switch (u.operation) {
+                case UpdateOperation.NEW:
+                        add_unit(u.id, u.path);
+                        break;
+                case UpdateOperation.REMOVE:
+                        /* Only here, rows also go away when the
+                         * filters change */
+                        if (dependency_graph_loaded)
+                                dependency_graph.clear_edges(u.id);
+
+                        remove_unit(u.id, u.path);
                         return;
+                default:
+                        break;
+                }
 
-                do {
-                        string name;
+                TreeIter iter;
 
-                        unit_model.get(iter, 0, out name);
+                if (unit_model.lookup_path(u.path, out iter))
+                        apply_unit_properties(u.path, iter, u.properties);
+        }
 
-                        if (id == name) {
-                                if (current_unit_id == name)
-                                        clear_unit();
+        private void flush_job_update(PendingUpdate u) {
+                switch (u.operation) {
+                case UpdateOperation.NEW:
+                        add_job(u.job_id, u.path);
+                        break;
+                case UpdateOperation.REMOVE:
+                        remove_job(u.job_id, u.path);
+                        return;
+                default:
+                        break;
+                }
 
-                                unit_model.remove(ref iter);
-                                break;
+                unowned TreeIter? iter = job_rows[u.path];
+                if (iter != null)
+                        apply_job_properties(iter, u.properties);
+        }
+
+        public void on_unit_new(string id, ObjectPath path) {
+                if (reloading)
+                        return;
+
+                /* Not something the list shows, it is fetched when the
+                 * type filter changes. The graph has all units though. */
+                if ((unit_type_button.mask & (1 << unit_type_from_id(id))) == 0) {
+                        if (dependency_graph_loaded) {
+                                dependency_fetch_queue.push_tail(path);
+                                if (!dependency_graph_stale)
+                                        fetch_next_dependencies();
                         }
 
-                } while (unit_model.iter_next(ref iter));
+                        return;
+                }
+
+                PendingUpdate u = get_pending_update(path, false);
+
+                u.operation = UpdateOperation.NEW;
+                u.id = id;
+        }
+
+        public void on_unit_removed(string id, ObjectPath path) {
+                if (reloading)
+                        return;
+
+                if (link_ids.contains(path)) {
+                        link_sub_states.remove(id);
+                        link_ids.remove(path);
+                        refresh_unit_links();
+                }
+
+                if (!is_unit_shown(path)) {
+                        if (dependency_graph_loaded)
+                                dependency_graph.clear_edges(id);
+
+                        return;
+                }
+
+                PendingUpdate u = get_pending_update(path, false);
+
+                u.operation = UpdateOperation.REMOVE;
+                u.id = id;
+                u.properties.remove_all();
+        }
+
+        public void on_job_new(uint32 id, ObjectPath path) {
+                if (reloading)
+                        return;
+
+                PendingUpdate u = get_pending_update(path, true);
 
-                unit_map.unset(id);
+                u.operation = UpdateOperation.NEW;
+                u.job_id = id;
         }
 
         public void on_job_removed(uint32 id, ObjectPath path, string res) {
-                TreeIter iter;
-                if (!(job_model.get_iter_first(out iter)))
+                TrackedJob? t = tracked_jobs[path];
+
+                if (t != null) {
+                        t.batch.jobs_finished++;
+                        if (res != "done")
+                                t.batch.jobs_failed++;
+
+                        /* The counts are only final once all replies
+                         * are in */
+                        if (t.batch.replies == t.batch.units)
+                                show_batch_status(t.batch);
+
+                        tracked_jobs.remove(path);
+                }
+
+                if (reloading)
                         return;
 
-                do {
-                        uint32 j;
+                PendingUpdate u = get_pending_update(path, true);
 
-                        job_model.get(iter, 5, out j);
+                u.operation = UpdateOperation.REMOVE;
+                u.job_id = id;
+                u.properties.remove_all();
+        }
 
-                        if (id == j) {
-                                if (current_job_id == j)
-                                        clear_job();
+        private void on_properties_changed(DBusConnection connection, string? sender_name, string object_path, string interface_name, string signal_name, Variant parameters) {
+                if (reloading)
+                        return;
 
-                                job_model.remove(ref iter);
+                string iface = parameters.get_child_value(0).get_string();
+                Variant changed_properties = parameters.get_child_value(1);
+                string[] invalidated_properties = parameters.get_child_value(2).dup_strv();
+
+                if (iface == "org.freedesktop.systemd1.Unit") {
+                        if (link_ids.contains(object_path))
+                                update_link_state(object_path, changed_properties);
+
+                        if (is_unit_shown(object_path))
+                                queue_properties(object_path, false, changed_properties, invalidated_properties);
+                        else if ((unit_type_button.mask & (1 << unit_type_from_path(object_path))) != 0 &&
+                                 (changed_properties.lookup_value("ActiveState", null) != null ||
+                                  changed_properties.lookup_value("Job", null) != null))
+                                schedule_unit_resync();
+                } else if (iface == "org.freedesktop.systemd1.Job")
+                        queue_properties(object_path, true, changed_properties, invalidated_properties);
+        }
 
-                                break;
-                        }
+        private void update_link_state(string path, Variant changed_properties) {
+                Variant? v = changed_properties.lookup_value("SubState", VariantType.STRING);
+
+                if (v == null)
+                        return;
+
+                link_sub_states[link_ids[path]] = unit_model.sub_states.intern(v.get_string());
+                refresh_unit_links();
+        }
+
+        private void schedule_unit_resync() {
+                if (unit_resync_timeout != 0)
+                        return;
+
+                unit_resync_timeout = Timeout.add(250, () => {
+                        unit_resync_timeout = 0;
 
-                } while (job_model.iter_next(ref iter));
+                        if (!reloading)
+                                populate_unit_model.begin();
+
+                        return false;
+                });
         }
 
-        public void on_unit_changed(Properties p, string iface, HashTable<string, Value?> changed_properties, string[] invalidated_properties) {
+        /* Units the filters left out are not in the model, changes to
+         * them are dropped right away instead of queued */
+        private bool is_unit_shown(string path) {
+                return unit_model.contains_path(path) || pending_updates.contains(path);
+        }
 
-                try {
+        private void add_unit(string id, string path) {
+
+                /* UnitNew is also sent for units we already know about */
+                if (!unit_model.contains_path(path)) {
                         TreeIter iter;
-                        string id;
 
-                        Unit u = Bus.get_proxy_sync(
-                                        user ? BusType.SESSION : BusType.SYSTEM,
-                                        p.get_name(),
-                                        p.get_object_path());
+                        unit_model.append(out iter, id, path);
+                }
+
+                fill_row.begin(path, false);
+        }
+
+        private void remove_unit(string id, string path) {
+                TreeIter iter;
+
+                if (!unit_model.lookup_path(path, out iter))
+                        return;
+
+                if (current_unit_id == id)
+                        clear_unit();
+
+                unit_model.remove(iter);
+        }
+
+        private void add_job(uint32 id, string path) {
+                if (job_rows.contains(path))
+                        return;
+
+                TreeIter iter;
+
+                job_model.append(out iter);
+                job_model.set(iter,
+                              0, "%u".printf(id),
+                              4, path,
+                              5, id);
 
-                        if (!(unit_model.get_iter_first(out iter)))
-                                return;
+                job_rows[path] = iter;
 
-                        id = u.id;
+                fill_row.begin(path, true);
+        }
 
-                        do {
-                                string name;
+        private void remove_job(uint32 id, string path) {
+                unowned TreeIter? i = job_rows[path];
+                if (i == null)
+                        return;
 
-                                unit_model.get(iter, 0, out name);
+                TreeIter iter = i;
 
-                                if (id == name) {
-                                        update_unit_iter(iter, id, u);
+                if (current_job_id == id)
+                        clear_job();
 
-                                        if (current_unit_id == id)
-                                                show_unit(u);
+                job_rows.remove(path);
 
-                                        break;
-                                }
+                job_model.remove(ref iter);
+        }
 
-                        } while (unit_model.iter_next(ref iter));
+        /* New rows are filled in from a GetAll, which goes through the
+         * pending updates like any other change */
+        private async void fill_row(string path, bool job) {
+                try {
+                        Variant properties = yield get_all_properties(
+                                        path,
+                                        job ? "org.freedesktop.systemd1.Job" : "org.freedesktop.systemd1.Unit");
 
+                        queue_properties(path, job, properties, new string[0]);
                 } catch (Error e) {
-                        show_error(e);
+                        /* Transient units and jobs might be gone already */
                 }
         }
 
-        public void on_job_changed(Properties p, string iface, HashTable<string, Value?> changed_properties, string[] invalidated_properties) {
+        private async void fetch_property(string path, bool job, string name) {
                 try {
-                        TreeIter iter;
-                        uint32 id;
+                        Variant value = yield get_property(
+                                        path,
+                                        job ? "org.freedesktop.systemd1.Job" : "org.freedesktop.systemd1.Unit",
+                                        name);
+
+                        PendingUpdate u = get_pending_update(path, job);
+                        if (u.operation != UpdateOperation.REMOVE)
+                                u.properties[name] = value;
+                } catch (Error e) {
+                        /* The object went away in the meantime */
+                }
+        }
 
-                        Job j = Bus.get_proxy_sync(
-                                        user ? BusType.SESSION : BusType.SYSTEM,
-                                        p.get_name(),
-                                        p.get_object_path());
+        public bool unit_filter(TreeModel model, TreeIter iter) {
+                /* The child model is always the unit model, so read the
+                 * records directly instead of going through GValues */
+                unowned string? id = unit_model.get_id(iter);
+
+                if (id == null)
+                        return false;
 
-                        if (!(job_model.get_iter_first(out iter)))
-                                return;
+                if (!unit_model.matches_search(iter))
+                        return false;
+
+                /* Both filters are bitmasks over the codes stored in
+                 * the record. Codes we have no bit for always pass. */
+                uint type = (uint) unit_model.get_unit_type(iter);
+                if (type < 32 && (unit_type_button.mask & (1U << type)) == 0)
+                        return false;
+
+                uint state = (uint) unit_model.get_active_state(iter);
+                if (state < 32 && (active_state_button.mask & (1U << state)) == 0
+                    && unit_model.get_job(iter) == JobType.NONE)
+                        return false;
+
+                return true;
+        }
 
-                        id = j.id;
+        /* The model only holds what the filters let through, so a
+         * change means fetching again */
+        public void unit_type_changed() {
+                unit_model_filter.refilter();
+                populate_unit_model.begin();
+        }
+
+        /* The index narrows the previous results when the query grows,
+         * the refilter then only does a hash lookup per row */
+        public void on_unit_search_changed() {
+                unit_model.set_search_query(unit_search_entry.get_text());
+                unit_model_filter.refilter();
+        }
 
-                        do {
-                                uint32 k;
+        public void on_graph_page_shown() {
+                if (graph_unit_entry.get_text() == "" && current_unit_id != null)
+                        graph_unit_entry.set_text(current_unit_id);
 
-                                job_model.get(iter, 5, out k);
+                if (!dependency_graph_loaded)
+                        load_dependency_graph();
 
-                                if (id == k) {
-                                        update_job_iter(iter, id, j);
+                update_graph_view();
+        }
+
+        /* Fetches the properties of all units, a window of requests at a
+         * time, so that they are pipelined on the bus connection. Later
+         * changes come in through PropertiesChanged. */
+        private void load_dependency_graph() {
+                dependency_graph_loaded = true;
+
+                /* Still loading: what is queued will be fetched again
+                 * anyway, start over once the requests in flight are
+                 * done */
+                if (dependency_fetches > 0) {
+                        dependency_fetch_queue.clear();
+                        dependency_graph_stale = true;
+                        return;
+                }
 
-                                        if (current_job_id == id)
-                                                show_job(j);
+                dependency_fetches++;
+                list_dependency_units.begin((o, r) => {
+                        list_dependency_units.end(r);
+                        dependency_request_done();
+                });
+        }
 
-                                        break;
-                                }
+        /* All units, not only those the filters let into the list. The
+         * call counts as a request in flight, so a load coming in
+         * meanwhile marks it stale. */
+        private async void list_dependency_units() {
+                graph_status_label.set_text("Loading dependencies");
 
-                        } while (job_model.iter_next(ref iter));
+                try {
+                        Manager.UnitInfo[] list = yield manager.list_units_async();
 
+                        if (!dependency_graph_stale)
+                                foreach (var i in list)
+                                        dependency_fetch_queue.push_tail(i.unit_path);
                 } catch (Error e) {
                         show_error(e);
                 }
         }
 
-        public bool unit_filter(TreeModel model, TreeIter iter) {
-                string id, active_state, job;
+        private void dependency_request_done() {
+                dependency_fetches--;
 
-                model.get(iter, 0, out id, 3, out active_state, 5, out job);
+                if (dependency_graph_stale) {
+                        if (dependency_fetches == 0) {
+                                dependency_graph_stale = false;
+                                load_dependency_graph();
+                        }
+                        return;
+                }
 
-                if (id == null)
-                        return false;
+                fetch_next_dependencies();
+        }
 
-                if (!inactive_checkbox.get_active()
-                    && active_state == "inactive" && job == "")
-                        return false;
+        private void fetch_next_dependencies() {
+                while (dependency_fetches < DEPENDENCY_FETCH_WINDOW && !dependency_fetch_queue.is_empty()) {
+                        dependency_fetches++;
+                        fetch_dependencies.begin(dependency_fetch_queue.pop_head(), (o, r) => {
+                                fetch_dependencies.end(r);
+                                dependency_request_done();
+                        });
+                }
 
-                switch (unit_type_combo_box.get_active()) {
-                case 0:
-                        return true;
-                case 1:
-                        return id.has_suffix(".target");
-                case 2:
-                        return id.has_suffix(".slice");
-                case 3:
-                        return id.has_suffix(".scope");
-                case 4:
-                        return id.has_suffix(".service");
-                case 5:
-                        return id.has_suffix(".device");
-                case 6:
-                        return id.has_suffix(".mount");
-                case 7:
-                        return id.has_suffix(".automount");
-                case 8:
-                        return id.has_suffix(".swap");
-                case 9:
-                        return id.has_suffix(".socket");
-                case 10:
-                        return id.has_suffix(".path");
-                case 11:
-                        return id.has_suffix(".timer");
-                case 12:
-                        return id.has_suffix(".snapshot");
-                default:
-                        assert(false);
-                        return false;
+                if (dependency_fetches == 0)
+                        update_graph_view();
+                else
+                        graph_status_label.set_text("Loading dependencies, %u units left".printf(
+                                                            dependency_fetch_queue.get_length() + dependency_fetches));
+        }
+
+        private async void fetch_dependencies(string path) {
+                try {
+                        Variant properties = yield get_all_properties(
+                                        path, "org.freedesktop.systemd1.Unit");
+                        Variant? id = properties.lookup_value("Id", VariantType.STRING);
+
+                        if (id != null)
+                                dependency_graph.set_properties(id.get_string(), properties);
+                } catch (Error e) {
+                        /* The unit went away in the meantime */
                 }
         }
 
-        public void unit_type_changed() {
-                TreeModelFilter model = (TreeModelFilter) ((TreeModelSort) unit_view.get_model()).get_model();
+        public void update_graph_view() {
+                string id = graph_unit_entry.get_text();
+                bool why = graph_mode_combo_box.get_active() == 1;
+                uint mask = 0;
+
+                for (int t = 0; t < graph_type_checks.length; t++)
+                        if (graph_type_checks[t].get_active())
+                                mask |= 1 << t;
+
+                if (id == "" || !dependency_graph.contains(id)) {
+                        dependency_graph_view.show_root(null, mask, why);
+                        graph_why_label.set_text_or_na();
+                        if (dependency_fetches == 0)
+                                graph_status_label.set_text(id == "" ? "" : "Unknown unit");
+                        return;
+                }
+
+                int64 start = get_monotonic_time();
+
+                dependency_graph_view.show_root(id, mask, why);
+                DependencyWalk w = dependency_graph_view.get_walk();
+
+                string[] chains = {};
+                if (why)
+                        chains = dependency_graph.why(id, 100000);
+
+                int64 elapsed = get_monotonic_time() - start;
+
+                graph_why_label.set_text_or_na(string.joinv("\n", chains));
+
+                if (dependency_fetches == 0)
+                        graph_status_label.set_text("%d units%s, %.1f ms".printf(
+                                                            w.ids.length,
+                                                            w.truncated ? " (truncated)" : "",
+                                                            elapsed / 1000.0));
+        }
+
+        public void on_graph_unit_activated(string id) {
+                graph_unit_entry.set_text(id);
+                update_graph_view();
+                on_activate_link(id);
+        }
+
+        /* A daemon-reload sends UnitRemoved, UnitNew and PropertiesChanged
+         * for pretty much every unit. Rather than processing those we
+         * drop everything queued and resync once when it is over. */
+        public void on_reloading(bool active) {
+                reloading = active;
+
+                if (active) {
+                        if (flush_tick != 0) {
+                                remove_tick_callback(flush_tick);
+                                flush_tick = 0;
+                        }
+
+                        return;
+                }
+
+                while (pending_queue.pop_head() != null)
+                        ;
+                pending_updates.remove_all();
+
+                try {
+                        populate_job_model();
+                } catch (Error e) {
+                        show_error(e);
+                }
+
+                populate_unit_model.begin();
+
+                /* Properties of the shown unit and the dependencies may
+                 * have changed with the configuration */
+                show_current_unit();
 
-                model.refilter();
+                if (dependency_graph_loaded)
+                        load_dependency_graph();
         }
 
         public void on_server_reload() {
@@ -996,8 +2708,9 @@ public class MainWindow : Window {
                 try {
                         manager.create_snapshot();
 
-                        if (unit_type_combo_box.get_active() != 0)
-                                unit_type_combo_box.set_active(12);
+                        /* Make sure the new snapshot is not filtered out */
+                        if (!unit_type_button.is_all())
+                                unit_type_button.set_choice(UnitType.SNAPSHOT);
                 } catch (Error e) {
                         show_error(e);
                 }
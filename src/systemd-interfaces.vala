@@ -42,10 +42,22 @@ public interface Manager : DBusProxy {
                 ObjectPath unit_path;
         }
 
+        public struct UnitFileInfo {
+                string path;
+                string state;
+        }
+
         public abstract string[] environment { owned get; }
 
-        public abstract UnitInfo[] list_units() throws DBusError, IOError;
+        [DBus (name = "ListUnits")]
+        public abstract async UnitInfo[] list_units_async() throws DBusError, IOError;
+        public abstract async UnitInfo[] list_units_filtered(string[] states) throws DBusError, IOError;
+        public abstract async UnitInfo[] list_units_by_patterns(string[] states, string[] patterns) throws DBusError, IOError;
+        public abstract async UnitInfo[] list_units_by_names(string[] names) throws DBusError, IOError;
         public abstract JobInfo[] list_jobs() throws DBusError, IOError;
+        [DBus (name = "ListJobs")]
+        public abstract async JobInfo[] list_jobs_async() throws DBusError, IOError;
+        public abstract async UnitFileInfo[] list_unit_files() throws DBusError, IOError;
 
         public abstract ObjectPath get_unit(string name) throws DBusError, IOError;
         public abstract ObjectPath get_unit_by_pid(uint32 pid) throws DBusError, IOError;
@@ -86,6 +98,8 @@ public interface Manager : DBusProxy {
         public abstract signal void unit_removed(string id, ObjectPath path);
         public abstract signal void job_new(uint32 id, ObjectPath path);
         public abstract signal void job_removed(uint32 id, ObjectPath path, string res);
+        public abstract signal void reloading(bool active);
+        public abstract signal void unit_files_changed();
 }
 
 [DBus (name = "org.freedesktop.systemd1.Unit")]
@@ -134,15 +148,9 @@ public interface Unit : DBusProxy {
         public abstract bool need_daemon_reload { owned get; }
         public abstract uint64 job_timeout_usec { owned get; }
 
-        public abstract ObjectPath start(string mode = "replace") throws DBusError, IOError;
-        public abstract ObjectPath stop(string mode = "replace") throws DBusError, IOError;
-        public abstract ObjectPath reload(string mode = "replace") throws DBusError, IOError;
-        public abstract ObjectPath restart(string mode = "replace") throws DBusError, IOError;
-        public abstract ObjectPath try_restart(string mode = "replace") throws DBusError, IOError;
-        public abstract ObjectPath reload_or_restart(string mode = "replace") throws DBusError, IOError;
-        public abstract ObjectPath reload_or_try_restart(string mode = "replace") throws DBusError, IOError;
-
-        public abstract void reset_failed() throws DBusError, IOError;
+        /* The unit actions go through GDBusConnection.call(), only the
+         * rolling restart uses the proxy */
+        public abstract async ObjectPath restart(string mode = "replace", Cancellable? cancellable = null) throws DBusError, IOError;
 }
 
 [DBus (name = "org.freedesktop.systemd1.Job")]
@@ -157,11 +165,5 @@ public interface Job : DBusProxy {
         public abstract string job_type { owned get; }
         public abstract UnitLink unit { owned get; }
 
-        public abstract void cancel() throws DBusError, IOError;
-}
-
-[DBus (name = "org.freedesktop.Properties")]
-public interface Properties : DBusProxy {
-        public abstract Variant? get(string iface, string property) throws DBusError, IOError;
-        public abstract signal void properties_changed(string iface, HashTable<string, Variant?> changed_properties, string[] invalidated_properties);
+        public abstract async void cancel(Cancellable? cancellable = null) throws DBusError, IOError;
 }
@@ -0,0 +1,654 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+using Gtk;
+using GLib;
+
+[Compact]
+public class PooledString {
+        public string str;
+        public uint refs;
+}
+
+/* Reference counted string interning. Descriptions and states repeat a
+ * lot across units, so only one copy of each is kept. */
+public class StringPool {
+
+        private HashTable<unowned string, PooledString> entries;
+
+        public StringPool() {
+                entries = new HashTable<unowned string, PooledString>(str_hash, str_equal);
+        }
+
+        public unowned string? intern(string? s) {
+                if (s == null)
+                        return null;
+
+                unowned PooledString? e = entries[s];
+
+                if (e == null) {
+                        PooledString n = new PooledString();
+                        n.str = s;
+                        n.refs = 0;
+
+                        e = n;
+                        unowned string key = n.str;
+                        entries.insert(key, (owned) n);
+                }
+
+                e.refs++;
+                return e.str;
+        }
+
+        public void release(string? s) {
+                if (s == null)
+                        return;
+
+                unowned PooledString? e = entries[s];
+                if (e == null)
+                        return;
+
+                if (--e.refs == 0)
+                        entries.remove(s);
+        }
+}
+
+/* Maps state strings to small integers. The states we know about are
+ * registered up front, in the order of the enums below, so that their
+ * codes match. Anything else gets the next free code when first seen.
+ * Code 0 is the empty string. */
+public class StateTable {
+
+        private Gee.HashMap<string, int> codes;
+        private string[] names = {};
+
+        public StateTable(string[] known) {
+                codes = new Gee.HashMap<string, int>();
+
+                intern("");
+                foreach (string s in known)
+                        intern(s);
+        }
+
+        public int intern(string? s) {
+                string name = s != null ? s : "";
+
+                if (codes.has_key(name))
+                        return codes[name];
+
+                int code = names.length;
+                names += name;
+                codes[name] = code;
+
+                return code;
+        }
+
+        public unowned string get_name(int code) {
+                return names[code];
+        }
+}
+
+public enum LoadState {
+        NONE,
+        STUB,
+        LOADED,
+        NOT_FOUND,
+        ERROR,
+        MERGED,
+        MASKED
+}
+
+const string[] LOAD_STATES = {
+        "stub",
+        "loaded",
+        "not-found",
+        "error",
+        "merged",
+        "masked"
+};
+
+public enum ActiveState {
+        NONE,
+        ACTIVE,
+        RELOADING,
+        INACTIVE,
+        FAILED,
+        ACTIVATING,
+        DEACTIVATING
+}
+
+const string[] ACTIVE_STATES = {
+        "active",
+        "reloading",
+        "inactive",
+        "failed",
+        "activating",
+        "deactivating"
+};
+
+/* Only the sub-states we treat specially, the others are interned as
+ * they show up */
+public enum SubState {
+        NONE,
+        DEAD,
+        RUNNING,
+        EXITED,
+        FAILED,
+        PLUGGED,
+        MOUNTED,
+        ACTIVE,
+        LISTENING,
+        WAITING,
+        ELAPSED
+}
+
+const string[] SUB_STATES = {
+        "dead",
+        "running",
+        "exited",
+        "failed",
+        "plugged",
+        "mounted",
+        "active",
+        "listening",
+        "waiting",
+        "elapsed"
+};
+
+public enum JobType {
+        NONE,
+        START,
+        VERIFY_ACTIVE,
+        STOP,
+        RELOAD,
+        RESTART,
+        TRY_RESTART,
+        RELOAD_OR_START,
+        NOP
+}
+
+const string[] JOB_TYPES = {
+        "start",
+        "verify-active",
+        "stop",
+        "reload",
+        "restart",
+        "try-restart",
+        "reload-or-start",
+        "nop"
+};
+
+public enum UnitType {
+        UNKNOWN,
+        TARGET,
+        SLICE,
+        SCOPE,
+        SERVICE,
+        DEVICE,
+        MOUNT,
+        AUTOMOUNT,
+        SWAP,
+        SOCKET,
+        PATH,
+        TIMER,
+        SNAPSHOT
+}
+
+public const string[] UNIT_TYPES = {
+        "target",
+        "slice",
+        "scope",
+        "service",
+        "device",
+        "mount",
+        "automount",
+        "swap",
+        "socket",
+        "path",
+        "timer",
+        "snapshot"
+};
+
+public UnitType unit_type_from_id(string id) {
+        int dot = id.last_index_of_char('.');
+
+        if (dot < 0)
+                return UnitType.UNKNOWN;
+
+        unowned string suffix = id.offset(dot + 1);
+
+        for (int i = 0; i < UNIT_TYPES.length; i++)
+                if (suffix == UNIT_TYPES[i])
+                        return (UnitType) (i + 1);
+
+        return UnitType.UNKNOWN;
+}
+
+/* Same for an object path, where the dot before the suffix is escaped
+ * as _2e */
+public UnitType unit_type_from_path(string path) {
+        for (int i = 0; i < UNIT_TYPES.length; i++)
+                if (path.has_suffix("_2e" + UNIT_TYPES[i]))
+                        return (UnitType) (i + 1);
+
+        return UnitType.UNKNOWN;
+}
+
+/* One row of the unit list. The id and object path are unique, the
+ * description comes from the model's string pool and the states are
+ * codes from its state tables. */
+public struct UnitRecord {
+        public string? id;
+        public string? path;
+        public unowned string? description;
+        public uint16 load_state;
+        public uint16 active_state;
+        public uint16 sub_state;
+        public uint16 job;
+
+        /* Parsed from the id suffix when the row is added */
+        public uint8 type;
+
+        /* Position in the model, -1 for free slots. Removed records
+         * keep their row, with a null id, until the model is
+         * compacted. */
+        public int row;
+}
+
+/* The unit list. Records are kept in one array and never move, so an
+ * iterator simply carries the slot index of its record and stays valid
+ * until the row is removed. The row order is a separate array of slot
+ * indexes. A removal only clears the record, so nothing has to shift;
+ * the row stays behind with a null id, which the view's filter hides,
+ * and compact() drops those rows in one pass. Columns are id,
+ * description, load state, active state, sub state, job, object path
+ * and unit type. The state and job columns are integer codes from the
+ * state tables, the unit type is a UnitType, the others are strings. */
+public class UnitModel : Object, TreeModel {
+
+        public StateTable load_states;
+        public StateTable active_states;
+        public StateTable sub_states;
+        public StateTable job_types;
+
+        /* Search over ids and descriptions, kept in sync with the
+         * records once the first query built it */
+        private SearchIndex search;
+
+        private StringPool strings;
+
+        private UnitRecord[] records = {};
+        private int[] free_slots = {};
+        private int[] rows = {};
+
+        /* Removed rows not compacted yet */
+        private int dead = 0;
+
+        /* Keyed by the strings the records own */
+        private HashTable<unowned string, int> ids;
+        private HashTable<unowned string, int> paths;
+
+        private int stamp;
+
+        public UnitModel() {
+                strings = new StringPool();
+                load_states = new StateTable(LOAD_STATES);
+                active_states = new StateTable(ACTIVE_STATES);
+                sub_states = new StateTable(SUB_STATES);
+                job_types = new StateTable(JOB_TYPES);
+                search = new SearchIndex();
+                ids = new HashTable<unowned string, int>(str_hash, str_equal);
+                paths = new HashTable<unowned string, int>(str_hash, str_equal);
+                stamp = (int) Random.next_int();
+        }
+
+        private void make_iter(out TreeIter iter, int slot) {
+                iter = TreeIter();
+                iter.stamp = stamp;
+                iter.user_data = (void*) (long) slot;
+        }
+
+        private static int slot_of(TreeIter iter) {
+                return (int) (long) iter.user_data;
+        }
+
+        private TreePath row_path(int row) {
+                TreePath path = new TreePath();
+                path.append_index(row);
+                return path;
+        }
+
+        public TreeModelFlags get_flags() {
+                return TreeModelFlags.LIST_ONLY | TreeModelFlags.ITERS_PERSIST;
+        }
+
+        public int get_n_columns() {
+                return 8;
+        }
+
+        public Type get_column_type(int index) {
+                if ((index >= 2 && index <= 5) || index == 7)
+                        return typeof(int);
+
+                return typeof(string);
+        }
+
+        public bool get_iter(out TreeIter iter, TreePath path) {
+                if (path.get_depth() != 1) {
+                        iter = TreeIter();
+                        return false;
+                }
+
+                return iter_nth_child(out iter, null, path.get_indices()[0]);
+        }
+
+        public TreePath? get_path(TreeIter iter) {
+                return row_path(records[slot_of(iter)].row);
+        }
+
+        public void get_value(TreeIter iter, int column, out Value val) {
+                int s = slot_of(iter);
+
+                val = Value(get_column_type(column));
+
+                switch (column) {
+                case 0:
+                        val.set_string(records[s].id);
+                        break;
+                case 1:
+                        val.set_string(records[s].description);
+                        break;
+                case 2:
+                        val.set_int(records[s].load_state);
+                        break;
+                case 3:
+                        val.set_int(records[s].active_state);
+                        break;
+                case 4:
+                        val.set_int(records[s].sub_state);
+                        break;
+                case 5:
+                        val.set_int(records[s].job);
+                        break;
+                case 6:
+                        val.set_string(records[s].path);
+                        break;
+                case 7:
+                        val.set_int(records[s].type);
+                        break;
+                }
+        }
+
+        public bool iter_next(ref TreeIter iter) {
+                int r = records[slot_of(iter)].row + 1;
+
+                if (r >= rows.length)
+                        return false;
+
+                iter.user_data = (void*) (long) rows[r];
+                return true;
+        }
+
+        public bool iter_previous(ref TreeIter iter) {
+                int r = records[slot_of(iter)].row - 1;
+
+                if (r < 0)
+                        return false;
+
+                iter.user_data = (void*) (long) rows[r];
+                return true;
+        }
+
+        public bool iter_children(out TreeIter iter, TreeIter? parent) {
+                return iter_nth_child(out iter, parent, 0);
+        }
+
+        public bool iter_has_child(TreeIter iter) {
+                return false;
+        }
+
+        public int iter_n_children(TreeIter? iter) {
+                return iter == null ? rows.length : 0;
+        }
+
+        public bool iter_nth_child(out TreeIter iter, TreeIter? parent, int n) {
+                if (parent != null || n < 0 || n >= rows.length) {
+                        iter = TreeIter();
+                        return false;
+                }
+
+                make_iter(out iter, rows[n]);
+                return true;
+        }
+
+        public bool iter_parent(out TreeIter iter, TreeIter child) {
+                iter = TreeIter();
+                return false;
+        }
+
+        public void append(out TreeIter iter,
+                           string id,
+                           string path,
+                           string? description = null,
+                           string? load_state = null,
+                           string? active_state = null,
+                           string? sub_state = null,
+                           string? job = null) {
+                int s;
+
+                if (free_slots.length > 0) {
+                        s = free_slots[free_slots.length - 1];
+                        free_slots.resize(free_slots.length - 1);
+                } else {
+                        s = records.length;
+                        records += UnitRecord();
+                }
+
+                records[s].id = id;
+                records[s].path = path;
+                records[s].description = strings.intern(description);
+                records[s].load_state = (uint16) load_states.intern(load_state);
+                records[s].active_state = (uint16) active_states.intern(active_state);
+                records[s].sub_state = (uint16) sub_states.intern(sub_state);
+                records[s].job = (uint16) job_types.intern(job);
+                records[s].type = (uint8) unit_type_from_id(id);
+                records[s].row = rows.length;
+                rows += s;
+
+                ids[records[s].id] = s;
+                paths[records[s].path] = s;
+
+                search.add(s, id, description);
+
+                make_iter(out iter, s);
+                row_inserted(row_path(records[s].row), iter);
+        }
+
+        /* Leaves the row behind, see compact() */
+        public void remove(TreeIter iter) {
+                int s = slot_of(iter);
+
+                ids.remove(records[s].id);
+                paths.remove(records[s].path);
+
+                search.remove(s, records[s].id, records[s].description);
+
+                strings.release(records[s].description);
+
+                records[s].id = null;
+                records[s].path = null;
+                records[s].description = null;
+                records[s].load_state = 0;
+                records[s].active_state = 0;
+                records[s].sub_state = 0;
+                records[s].job = 0;
+                records[s].type = UnitType.UNKNOWN;
+                dead++;
+
+                row_changed(row_path(records[s].row), iter);
+        }
+
+        /* Worth a compact() once a quarter of the rows are gone */
+        public bool needs_compaction() {
+                return dead >= 256 && dead * 4 >= rows.length;
+        }
+
+        /* Drops the removed rows in one pass and frees their slots. The
+         * rows go away without row-deleted, so this may only be called
+         * while no view is attached. */
+        public void compact() {
+                if (dead == 0)
+                        return;
+
+                int n = 0;
+
+                for (int r = 0; r < rows.length; r++) {
+                        int s = rows[r];
+
+                        if (records[s].id == null) {
+                                records[s].row = -1;
+                                free_slots += s;
+                                continue;
+                        }
+
+                        rows[n] = s;
+                        records[s].row = n;
+                        n++;
+                }
+
+                rows.resize(n);
+                dead = 0;
+        }
+
+        /* Sets the description or one of the state columns from its
+         * string, row-changed is only emitted if the value actually
+         * changed */
+        public void set_column(TreeIter iter, int column, string? value) {
+                int s = slot_of(iter);
+                unowned string? v, old;
+                uint16 code;
+                bool changed;
+
+                switch (column) {
+                case 1:
+                        v = strings.intern(value);
+                        old = records[s].description;
+                        records[s].description = v;
+
+                        /* Interned, so comparing the pointers is enough */
+                        changed = (void*) old != (void*) v;
+
+                        if (changed)
+                                search.update(s, records[s].id, old, v);
+
+                        strings.release(old);
+                        break;
+                case 2:
+                        code = (uint16) load_states.intern(value);
+                        changed = records[s].load_state != code;
+                        records[s].load_state = code;
+                        break;
+                case 3:
+                        code = (uint16) active_states.intern(value);
+                        changed = records[s].active_state != code;
+                        records[s].active_state = code;
+                        break;
+                case 4:
+                        code = (uint16) sub_states.intern(value);
+                        changed = records[s].sub_state != code;
+                        records[s].sub_state = code;
+                        break;
+                case 5:
+                        code = (uint16) job_types.intern(value);
+                        changed = records[s].job != code;
+                        records[s].job = code;
+                        break;
+                default:
+                        assert_not_reached();
+                }
+
+                if (changed)
+                        row_changed(row_path(records[s].row), iter);
+        }
+
+        public bool lookup_id(string id, out TreeIter iter) {
+                int s;
+
+                if (!ids.lookup_extended(id, null, out s)) {
+                        iter = TreeIter();
+                        return false;
+                }
+
+                make_iter(out iter, s);
+                return true;
+        }
+
+        public bool lookup_path(string path, out TreeIter iter) {
+                int s;
+
+                if (!paths.lookup_extended(path, null, out s)) {
+                        iter = TreeIter();
+                        return false;
+                }
+
+                make_iter(out iter, s);
+                return true;
+        }
+
+        public bool contains_path(string path) {
+                return paths.contains(path);
+        }
+
+        public unowned string? get_id(TreeIter iter) {
+                return records[slot_of(iter)].id;
+        }
+
+        public unowned string? get_object_path(TreeIter iter) {
+                return records[slot_of(iter)].path;
+        }
+
+        public ActiveState get_active_state(TreeIter iter) {
+                return (ActiveState) records[slot_of(iter)].active_state;
+        }
+
+        public SubState get_sub_state(TreeIter iter) {
+                return (SubState) records[slot_of(iter)].sub_state;
+        }
+
+        public JobType get_job(TreeIter iter) {
+                return (JobType) records[slot_of(iter)].job;
+        }
+
+        public bool matches_search(TreeIter iter) {
+                return search.matches(slot_of(iter));
+        }
+
+        public void set_search_query(string? query) {
+                search.set_query(query, get_search_text, records.length);
+        }
+
+        private string? get_search_text(int slot) {
+                if (records[slot].id == null)
+                        return null;
+
+                return SearchIndex.make_text(records[slot].id, records[slot].description);
+        }
+
+        public UnitType get_unit_type(TreeIter iter) {
+                return (UnitType) records[slot_of(iter)].type;
+        }
+}
@@ -0,0 +1,237 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+using GLib;
+
+/* Text of a slot for the search, lowercased, null for free slots */
+public delegate string? SearchTextFunc(int slot);
+
+/* The slots one trigram occurs in, sorted. Most slots are added in
+ * increasing order, so inserting rarely has to move anything. */
+[Compact]
+class SearchPostings {
+
+        private int[] slots;
+
+        private int find(int slot) {
+                int lo = 0, hi = slots.length;
+
+                while (lo < hi) {
+                        int mid = (lo + hi) / 2;
+
+                        if (slots[mid] < slot)
+                                lo = mid + 1;
+                        else
+                                hi = mid;
+                }
+
+                return lo;
+        }
+
+        public void add(int slot) {
+                int i = find(slot);
+
+                if (i < slots.length && slots[i] == slot)
+                        return;
+
+                slots += slot;
+                for (int j = slots.length - 1; j > i; j--)
+                        slots[j] = slots[j - 1];
+                slots[i] = slot;
+        }
+
+        public void remove(int slot) {
+                int i = find(slot);
+
+                if (i == slots.length || slots[i] != slot)
+                        return;
+
+                for (int j = i; j < slots.length - 1; j++)
+                        slots[j] = slots[j + 1];
+                slots.resize(slots.length - 1);
+        }
+
+        public int length() {
+                return slots.length;
+        }
+
+        public unowned int[] get_slots() {
+                return slots;
+        }
+}
+
+/* Case insensitive substring search over the id and description of the
+ * units, keyed by the unit model's slots. Every trigram of the lowercased
+ * text maps to the slots containing it, so a query only has to look at
+ * the slots of its rarest trigram. A query that extends the previous one
+ * only looks at the previous results. The index is only built for the
+ * first query and kept up to date from then on; the texts themselves
+ * are not kept, candidates are checked against the model's. */
+public class SearchIndex {
+
+        private HashTable<uint, SearchPostings> trigrams;
+        private SearchPostings all;
+        private bool built = false;
+
+        private string? query = null;
+        private Gee.HashSet<int>? results = null;
+
+        public SearchIndex() {
+                trigrams = new HashTable<uint, SearchPostings>(direct_hash, direct_equal);
+                all = new SearchPostings();
+        }
+
+        public static string make_text(string id, string? description) {
+                if (description == null)
+                        return id.down();
+
+                return (id + "\n" + description).down();
+        }
+
+        /* Byte trigrams packed into an int, substring matches of UTF-8
+         * text are byte substring matches anyway. Never 0, the text
+         * has no NULs. */
+        private static uint trigram_at(string text, int i) {
+                return ((uint) (uchar) text[i] << 16) |
+                       ((uint) (uchar) text[i + 1] << 8) |
+                       (uint) (uchar) text[i + 2];
+        }
+
+        private void index_text(int slot, string text) {
+                for (int i = 0; i + 3 <= text.length; i++) {
+                        uint t = trigram_at(text, i);
+                        unowned SearchPostings? p = trigrams[t];
+
+                        if (p == null) {
+                                trigrams[t] = new SearchPostings();
+                                p = trigrams[t];
+                        }
+
+                        p.add(slot);
+                }
+
+                all.add(slot);
+        }
+
+        private void unindex_text(int slot, string text) {
+                for (int i = 0; i + 3 <= text.length; i++) {
+                        uint t = trigram_at(text, i);
+                        unowned SearchPostings? p = trigrams[t];
+
+                        if (p == null)
+                                continue;
+
+                        p.remove(slot);
+                        if (p.length() == 0)
+                                trigrams.remove(t);
+                }
+
+                all.remove(slot);
+        }
+
+        public void add(int slot, string id, string? description) {
+                if (!built)
+                        return;
+
+                string text = make_text(id, description);
+
+                index_text(slot, text);
+
+                if (query != null && query in text)
+                        results.add(slot);
+        }
+
+        /* Takes the id and description the slot was added with */
+        public void remove(int slot, string id, string? description) {
+                if (!built)
+                        return;
+
+                unindex_text(slot, make_text(id, description));
+
+                if (results != null)
+                        results.remove(slot);
+        }
+
+        public void update(int slot, string id, string? old_description, string? description) {
+                if (!built)
+                        return;
+
+                remove(slot, id, old_description);
+                add(slot, id, description);
+        }
+
+        public bool matches(int slot) {
+                return query == null || results.contains(slot);
+        }
+
+        /* Sets the query, an empty one matches everything. The first
+         * one builds the index from the texts of slots 0 to n_slots. */
+        public void set_query(string? q, SearchTextFunc text_of, int n_slots) {
+                if (q == null || q == "") {
+                        query = null;
+                        results = null;
+                        return;
+                }
+
+                if (!built) {
+                        for (int slot = 0; slot < n_slots; slot++) {
+                                string? text = text_of(slot);
+
+                                if (text != null)
+                                        index_text(slot, text);
+                        }
+
+                        built = true;
+                }
+
+                string lq = q.down();
+
+                if (query != null && lq == query)
+                        return;
+
+                Gee.HashSet<int> r = new Gee.HashSet<int>();
+
+                if (query != null && query in lq) {
+                        foreach (int slot in results)
+                                if (lq in text_of(slot))
+                                        r.add(slot);
+                } else {
+                        unowned SearchPostings? smallest = all;
+
+                        for (int i = 0; i + 3 <= lq.length; i++) {
+                                unowned SearchPostings? p = trigrams[trigram_at(lq, i)];
+
+                                /* Some trigram occurs nowhere */
+                                if (p == null) {
+                                        smallest = null;
+                                        break;
+                                }
+
+                                if (p.length() < smallest.length())
+                                        smallest = p;
+                        }
+
+                        if (smallest != null)
+                                foreach (int slot in smallest.get_slots())
+                                        if (lq in text_of(slot))
+                                                r.add(slot);
+                }
+
+                query = lq;
+                results = r;
+        }
+}